@@ -0,0 +1,648 @@
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "dbparser.h"
+#include "follow.h"
+#include "gradestats.h"
+#include "mappedfile.h"
+#include "numparse.h"
+#include "recordstore.h"
+#include "recordwriter.h"
+#include "runstats.h"
+#include "studentrecord.h"
+
+using namespace std;
+
+/*
+ * Benchmarks for the querydb loader
+ *
+ * querydb-bench threads <database file> [max threads]
+ *      Parses the database with 1, 2, 4 ... <max threads> threads (default: one per processor)
+ *      and writes the time, throughput and speedup of each run.
+ *      Every run is checked against the sequential parser, record for record.
+ *
+ * querydb-bench memory [records]
+ *      Generates and parses a database of <records> students (default 1000000) and writes the heap
+ *      memory used per record in a RecordStore, in a vector<Record> (enrollments as module IDs)
+ *      and in a vector<Record> with one std::string per module code.
+ *
+ * querydb-bench grades [tokens]
+ *      Parses <tokens> grades (default 5000000), laid out as #GRADES lines, with the original
+ *      stringstream + stof loop and with parseFloat, and writes the time and heap allocations per token.
+ *
+ * querydb-bench follow <scratch file> [records] [appends]
+ *      Writes a database of <records> students (default 300000) to <scratch file>, then appends
+ *      <appends> records (default 1000) one at a time, reloading after each with FollowedDatabase.
+ *      Writes the reload time, and checks the result against a full parse of the final file.
+ *
+ * querydb-bench aggregate [records]
+ *      Generates and parses <records> students (default 1000000) and times the per-module statistics
+ *      with the plain loops and with the SIMD kernels, checking that both give the same results.
+ *
+ * querydb-bench output [records] [endl|buffered|async]
+ *      Writes <records> generated students (default 1000000) to standard output, as -showAll does,
+ *      either one flush per line (the original printRecord), through RecordWriter, or through
+ *      RecordWriter with a writer thread. Redirect the output to /dev/null or a pipe; the
+ *      records per second go to stderr. Both layouts are first checked to give the same bytes.
+ *
+ * querydb-bench scan [records] [store|vector]
+ *      Builds <records> students (default 1000000) in a RecordStore or a vector<Record> and times
+ *      scans over one field at a time, then writes the heap used and the peak resident set size.
+ *      Run it once per layout, so the peak sizes do not mix.
+*/
+
+//Heap accounting for the benchmarks, from the counting operator new and delete that the tools use for
+//-stats (countingnew.cpp). Every allocation is counted, and its size followed, while countAllocations is set
+static atomic<bool>& countAllocations = allocationCounters.counting;
+static atomic<long long>& liveBytes = allocationCounters.liveBytes;
+static atomic<long long>& allocations = allocationCounters.calls;
+
+//Function to compare two records field by field
+static bool sameRecord(const RecordView& a, const RecordView& b)
+{
+    return a.SID == b.SID && a.name == b.name && a.phone == b.phone
+        && equal(a.enrollments.begin(), a.enrollments.end(), b.enrollments.begin(), b.enrollments.end())
+        && equal(a.grades.begin(), a.grades.end(), b.grades.begin(), b.grades.end());
+}
+
+//Time `runs` parses of `text` with `threads` threads and return the fastest, in seconds
+static double timeParse(string_view text, unsigned threads, int runs, RecordStore& db)
+{
+    double best = 0;
+    for (int run = 0; run < runs; run++) {
+        db.clear();
+        auto start = chrono::steady_clock::now();
+        parseDatabaseParallel(text, db, threads);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (run == 0 || seconds < best) {
+            best = seconds;
+        }
+    }
+    return best;
+}
+
+static int benchThreads(const string& dataBaseName, unsigned maxThreads)
+{
+    MappedFile file;
+    if (!file.open(dataBaseName)) {
+        cerr << "Cannot open file " << dataBaseName << endl;
+        return EXIT_FAILURE;
+    }
+
+    const int runs = 3;
+    RecordStore expected;
+    RecordStore db;
+    double baseline = timeParse(file.view(), 1, runs, expected);
+
+    //1, 2, 4 ... and finally maxThreads itself
+    vector<unsigned> counts;
+    for (unsigned threads = 1; threads < maxThreads; threads *= 2) {
+        counts.push_back(threads);
+    }
+    counts.push_back(maxThreads);
+
+    cout << "threads,seconds,mb_per_s,speedup,identical" << endl;
+    for (unsigned threads : counts) {
+        double seconds = threads == 1 ? baseline : timeParse(file.view(), threads, runs, db);
+        bool identical = true;
+        if (threads > 1) {
+            identical = db.size() == expected.size();
+            for (size_t i = 0; identical && i < db.size(); i++) {
+                identical = sameRecord(db[i], expected[i]);
+            }
+        }
+        cout << threads << "," << seconds << "," << file.size() / 1e6 / seconds << ","
+             << baseline / seconds << "," << (identical ? "yes" : "NO") << endl;
+        if (!identical) {
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+//Write a database of `count` made up students, with 1-8 enrollments from a few hundred module codes
+static string generateText(size_t count)
+{
+    stringstream op;
+    unsigned seed = 12345;
+    auto next = [&seed](unsigned range) {
+        seed = seed * 1103515245u + 12345u;
+        return (seed >> 16) % range;
+    };
+    for (size_t n = 0; n < count; n++) {
+        unsigned modules = 1 + next(8);
+        op << "#RECORD\n #SID\n     " << 100000 + n << "\n #NAME\n     Student" << n << " Surname" << next(5000) << "\n";
+        op << " #ENROLLMENTS\n    ";
+        for (unsigned m = 0; m < modules; m++) {
+            op << " COMP" << 100 + next(300);
+        }
+        op << "\n #GRADES\n    ";
+        for (unsigned m = 0; m < modules; m++) {
+            op << " " << next(100) << "." << next(10);
+        }
+        op << "\n";
+        if (next(2)) {
+            op << " #PHONE\n     44-" << 1000 + next(9000) << "-" << 100000 + next(900000) << "\n";
+        }
+        op << "\n";
+    }
+    return op.str();
+}
+
+//Copy every record of `db` out into a vector<Record>
+static vector<Record> toVector(const RecordStore& db)
+{
+    vector<Record> records;
+    records.reserve(db.size());
+    for (size_t n = 0; n < db.size(); n++) {
+        records.push_back(db.record(n));
+    }
+    return records;
+}
+
+static int benchMemory(size_t count)
+{
+    string text = generateText(count);
+
+    countAllocations = true;
+    long long before = liveBytes;
+    RecordStore db;
+    parseDatabase(text, db);
+    long long storeBytes = liveBytes - before;
+
+    //The same records as one struct each, with enrollments as IDs
+    before = liveBytes;
+    vector<Record> records = toVector(db);
+    long long recordBytes = liveBytes - before;
+
+    //...and with one std::string per module code in place of each ID (the vector<string> is the same size)
+    size_t enrollments = 0;
+    long long idBytes = 0;
+    long long stringBytes = 0;
+    for (const Record& r : records) {
+        idBytes += static_cast<long long>(r.enrollments.capacity() * sizeof(ModuleId));
+        enrollments += r.enrollments.size();
+        before = liveBytes;
+        vector<string> codes;
+        for (ModuleId id : r.enrollments) {
+            codes.push_back(moduleName(id));
+        }
+        stringBytes += liveBytes - before;
+    }
+    countAllocations = false;
+
+    double n = static_cast<double>(db.size());
+    cout << "records,enrollments,module_codes,bytes_per_record_store,bytes_per_record_vector,"
+            "bytes_per_record_vector_strings,enrollment_bytes_per_record_ids,enrollment_bytes_per_record_strings" << endl;
+    cout << db.size() << "," << enrollments << "," << moduleDictionary().size() << ","
+         << storeBytes / n << "," << recordBytes / n << "," << (recordBytes - idBytes + stringBytes) / n << ","
+         << idBytes / n << "," << stringBytes / n << endl;
+    return EXIT_SUCCESS;
+}
+
+//Grades as they appear in a database: lines of 1-8 grades separated by spaces
+static vector<string> generateGradeLines(size_t tokens)
+{
+    vector<string> lines;
+    unsigned seed = 12345;
+    auto next = [&seed](unsigned range) {
+        seed = seed * 1103515245u + 12345u;
+        return (seed >> 16) % range;
+    };
+    for (size_t n = 0; n < tokens;) {
+        string line = "   ";
+        for (unsigned m = 1 + next(8); m > 0 && n < tokens; m--, n++) {
+            line += " " + to_string(next(100)) + "." + to_string(next(10));
+        }
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+//The GRADES case of parseDatabaseLegacy
+static double gradesStringstream(const vector<string>& lines)
+{
+    double sum = 0;
+    stringstream moduleGrades;
+    string moduleGrade;
+    for (const string& nextStr : lines) {
+        moduleGrades = stringstream(nextStr);
+        while (moduleGrades.eof() == false) {
+            moduleGrades >> moduleGrade;
+            if (moduleGrades.fail()) {
+                break;
+            }
+            sum += stof(moduleGrade);
+        }
+    }
+    return sum;
+}
+
+//The GRADES case of parseDatabase
+static double gradesParseFloat(const vector<string>& lines)
+{
+    double sum = 0;
+    for (const string& nextStr : lines) {
+        string_view line = nextStr;
+        size_t pos = line.find_first_not_of(' ');
+        while (pos != string_view::npos) {
+            size_t end = line.find(' ', pos);
+            string_view grade = line.substr(pos, end == string_view::npos ? string_view::npos : end - pos);
+            float g;
+            NumberResult result = parseFloat(grade, g);
+            if (!result.ok()) {
+                throw runtime_error(numberErrorMessage(result, grade, "grade"));
+            }
+            sum += g;
+            pos = end == string_view::npos ? end : line.find_first_not_of(' ', end);
+        }
+    }
+    return sum;
+}
+
+static int benchGrades(size_t tokens)
+{
+    vector<string> lines = generateGradeLines(tokens);
+
+    struct Method {
+        const char* name;
+        double (*parse)(const vector<string>&);
+    };
+    const Method methods[] = {
+        {"stringstream_stof", gradesStringstream},
+        {"parsefloat", gradesParseFloat}
+    };
+
+    const int runs = 3;
+    double expected = 0;
+    cout << "method,tokens,seconds,ns_per_token,allocations_per_token,identical" << endl;
+    for (const Method& method : methods) {
+        double best = 0;
+        double sum = 0;
+        long long allocated = 0;
+        for (int run = 0; run < runs; run++) {
+            countAllocations = true;
+            long long before = allocations;
+            auto start = chrono::steady_clock::now();
+            sum = method.parse(lines);
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            allocated = allocations - before;
+            countAllocations = false;
+            if (run == 0 || seconds < best) {
+                best = seconds;
+            }
+        }
+        if (&method == methods) {
+            expected = sum;
+        }
+        cout << method.name << "," << tokens << "," << best << "," << best * 1e9 / tokens << ","
+             << double(allocated) / tokens << "," << (sum == expected ? "yes" : "NO") << endl;
+        if (sum != expected) {
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+static int benchFollow(const string& fileName, size_t records, size_t appends)
+{
+    {
+        ofstream op(fileName, ios::binary | ios::trunc);
+        op << generateText(records);
+        if (!op) {
+            cerr << "Cannot write " << fileName << endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    RecordStore db;
+    FollowedDatabase followed(db);
+    auto loadStart = chrono::steady_clock::now();
+    if (!followed.open(fileName)) {
+        cerr << "Cannot open file " << fileName << endl;
+        return EXIT_FAILURE;
+    }
+    double loadSeconds = chrono::duration<double>(chrono::steady_clock::now() - loadStart).count();
+
+    //Append one student at a time, as addrecord does
+    double total = 0;
+    double worst = 0;
+    size_t tails = 0;
+    for (size_t n = 0; n < appends; n++) {
+        {
+            ofstream op(fileName, ios::binary | ios::app);
+            op << "#RECORD\n #SID\n     " << 900000000 + n << "\n #NAME\n     Added Student" << n
+               << "\n #ENROLLMENTS\n     COMP101 COMP102\n #GRADES\n     61.5 72\n";
+        }
+        auto start = chrono::steady_clock::now();
+        if (followed.reload() == FollowedDatabase::APPENDED) {
+            tails++;
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        total += seconds;
+        worst = max(worst, seconds);
+    }
+
+    //The followed records must be exactly what a fresh load gives
+    MappedFile file;
+    RecordStore expected;
+    if (!file.open(fileName)) {
+        cerr << "Cannot open file " << fileName << endl;
+        return EXIT_FAILURE;
+    }
+    parseDatabase(file.view(), expected);
+    bool identical = db.size() == expected.size();
+    for (size_t i = 0; identical && i < db.size(); i++) {
+        identical = sameRecord(db[i], expected[i]);
+    }
+
+    cout << "records,appends,tail_reloads,full_load_seconds,mean_reload_us,max_reload_us,identical" << endl;
+    cout << records << "," << appends << "," << tails << "," << loadSeconds << ","
+         << (appends ? total / appends * 1e6 : 0) << "," << worst * 1e6 << "," << (identical ? "yes" : "NO") << endl;
+    return identical && tails == appends ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int benchAggregate(size_t count)
+{
+    RecordStore db;
+    {
+        string text = generateText(count);
+        parseDatabase(text, db);
+    }
+    size_t enrollments = db.enrollmentArena().size();
+
+    const int runs = 3;
+    vector<ModuleStats> expected;
+    cout << "kernel,records,enrollments,seconds,identical" << endl;
+    for (bool vectorized : {false, true}) {
+        double best = 0;
+        vector<ModuleStats> stats;
+        for (int run = 0; run < runs; run++) {
+            auto start = chrono::steady_clock::now();
+            stats = moduleStatistics(db, 40, vectorized);
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            if (run == 0 || seconds < best) {
+                best = seconds;
+            }
+        }
+        if (!vectorized) {
+            expected = stats;
+        }
+
+        //Only the mean may differ, as the SIMD kernel adds the grades up in a different order
+        bool identical = stats.size() == expected.size();
+        for (size_t m = 0; identical && m < stats.size(); m++) {
+            const ModuleStats& a = stats[m];
+            const ModuleStats& b = expected[m];
+            identical = a.module == b.module && a.count == b.count && a.min == b.min && a.max == b.max
+                && a.median == b.median && a.passRate == b.passRate && a.histogram == b.histogram
+                && fabs(a.mean - b.mean) <= 1e-9 * fabs(b.mean);
+        }
+        cout << (vectorized ? "simd" : "scalar") << "," << db.size() << "," << enrollments << "," << best << ","
+             << (identical ? "yes" : "NO") << endl;
+        if (!identical) {
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+//The original printRecord, flushing every line
+static void printRecordEndl(ostream& out, const RecordView& r)
+{
+    out << "SID:" << endl;
+    out << "   " << r.SID << endl;
+    out << "NAME:" << endl;
+    out << "   " << r.name << endl;
+    out << "ENROLLMENTS:" << endl;
+    out << "   ";
+    for (ModuleId id : r.enrollments) {
+        out << moduleName(id) << " ";
+    }
+    out << endl;
+    out << "GRADES:" << endl;
+    out << "   ";
+    for (float g : r.grades) {
+        out << g << " ";
+    }
+    out << endl;
+    if (!r.phone.empty()) {
+        out << "PHONE:" << endl;
+        out << "   " << r.phone << endl;
+    }
+}
+
+static int benchOutput(size_t count, const string& method)
+{
+    RecordStore db;
+    {
+        string text = generateText(count);
+        parseDatabase(text, db);
+    }
+
+    //Check the two give the same bytes, including numbers that need an exponent or rounding
+    {
+        RecordStore sample;
+        vector<float> awkward = {0, -0.0f, 100, 1e6f, 1234567, 0.0001f, 1e-5f, 99.99999f, 12.345678f, -3.5f, 3e38f};
+        vector<ModuleId> codes(awkward.size(), moduleId("COMP101"));
+        Record r{};
+        r.SID = -42;
+        r.name = "Awkward Numbers";
+        r.enrollments = codes;
+        r.grades = awkward;
+        sample.add(r);
+        for (size_t n = 0; n < min<size_t>(db.size(), 10000); n++) {
+            sample.add(db[n]);
+        }
+
+        ostringstream expected;
+        ostringstream buffered;
+        {
+            RecordWriter out(buffered);
+            for (size_t n = 0; n < sample.size(); n++) {
+                printRecordEndl(expected, sample[n]);
+                expected << endl;
+                out.writeRecord(sample[n]);
+                out << '\n';
+            }
+        }
+        if (expected.str() != buffered.str()) {
+            cerr << "RecordWriter output differs from printRecord" << endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    auto start = chrono::steady_clock::now();
+    if (method == "endl") {
+        for (size_t n = 0; n < db.size(); n++) {
+            printRecordEndl(cout, db[n]);
+            cout << endl;
+        }
+    } else if (method == "buffered" || method == "async") {
+        RecordWriter out(cout, RecordWriter::BLOCK_SIZE, method == "async");
+        for (size_t n = 0; n < db.size(); n++) {
+            out.writeRecord(db[n]);
+            out << '\n';
+        }
+    } else {
+        cerr << "Unknown output method " << method << endl;
+        return EXIT_FAILURE;
+    }
+    cout.flush();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cerr << "method,records,seconds,records_per_s" << endl;
+    cerr << method << "," << db.size() << "," << seconds << "," << db.size() / seconds << endl;
+    return EXIT_SUCCESS;
+}
+
+//Scans over one field of every record, as a query or report would make them
+struct ScanResult {
+    int maxSID = 0;
+    double gradeSum = 0;
+    size_t nameBytes = 0;
+};
+
+static ScanResult scanFields(const RecordStore& db)
+{
+    ScanResult result;
+    for (int sid : db.sidColumn()) {
+        result.maxSID = max(result.maxSID, sid);
+    }
+    for (float g : db.gradeArena()) {
+        result.gradeSum += g;
+    }
+    for (size_t n = 0; n < db.size(); n++) {
+        result.nameBytes += db[n].name.size();
+    }
+    return result;
+}
+
+static ScanResult scanFields(const vector<Record>& db)
+{
+    ScanResult result;
+    for (const Record& r : db) {
+        result.maxSID = max(result.maxSID, r.SID);
+    }
+    for (const Record& r : db) {
+        for (float g : r.grades) {
+            result.gradeSum += g;
+        }
+    }
+    for (const Record& r : db) {
+        result.nameBytes += r.name.size();
+    }
+    return result;
+}
+
+//Build `count` records in `db` and time the field scans
+template <typename Database>
+static int benchScan(const string& layout, size_t count, Database& db, void (*fill)(Database&, const RecordStore&))
+{
+    //Parse into a store first, so both layouts are built from exactly the same records
+    RecordStore parsed;
+    {
+        string text = generateText(count);
+        parseDatabase(text, parsed);
+    }
+
+    countAllocations = true;
+    long long before = liveBytes;
+    auto buildStart = chrono::steady_clock::now();
+    fill(db, parsed);
+    double buildSeconds = chrono::duration<double>(chrono::steady_clock::now() - buildStart).count();
+    long long heapBytes = liveBytes - before;
+    countAllocations = false;
+    parsed.clear();
+
+    const int runs = 5;
+    double best = 0;
+    ScanResult result;
+    for (int run = 0; run < runs; run++) {
+        auto start = chrono::steady_clock::now();
+        result = scanFields(db);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (run == 0 || seconds < best) {
+            best = seconds;
+        }
+    }
+
+    cout << "layout,records,build_seconds,scan_seconds,heap_bytes,peak_rss_bytes,max_sid,grade_sum,name_bytes" << endl;
+    cout << layout << "," << count << "," << buildSeconds << "," << best << "," << heapBytes << ","
+         << peakResidentBytes() << "," << result.maxSID << "," << result.gradeSum << "," << result.nameBytes << endl;
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        cerr << "Usage: querydb-bench threads <database file> [max threads]" << endl;
+        cerr << "       querydb-bench memory [records]" << endl;
+        cerr << "       querydb-bench grades [tokens]" << endl;
+        cerr << "       querydb-bench follow <scratch file> [records] [appends]" << endl;
+        cerr << "       querydb-bench aggregate [records]" << endl;
+        cerr << "       querydb-bench output [records] [endl|buffered|async]" << endl;
+        cerr << "       querydb-bench scan [records] [store|vector]" << endl;
+        return EXIT_FAILURE;
+    }
+
+    string mode = argv[1];
+    try {
+        if (mode == "memory") {
+            return benchMemory(argc > 2 ? static_cast<size_t>(stoul(argv[2])) : 1000000);
+        }
+        if (mode == "grades") {
+            return benchGrades(argc > 2 ? static_cast<size_t>(stoul(argv[2])) : 5000000);
+        }
+        if (mode == "aggregate") {
+            return benchAggregate(argc > 2 ? static_cast<size_t>(stoul(argv[2])) : 1000000);
+        }
+        if (mode == "output") {
+            return benchOutput(argc > 2 ? static_cast<size_t>(stoul(argv[2])) : 1000000, argc > 3 ? argv[3] : "buffered");
+        }
+        if (mode == "scan") {
+            size_t count = argc > 2 ? static_cast<size_t>(stoul(argv[2])) : 1000000;
+            string layout = argc > 3 ? argv[3] : "store";
+            if (layout == "store") {
+                RecordStore db;
+                return benchScan<RecordStore>(layout, count, db, [](RecordStore& db, const RecordStore& parsed) {
+                    db.append(parsed);
+                });
+            }
+            if (layout == "vector") {
+                vector<Record> db;
+                return benchScan<vector<Record>>(layout, count, db, [](vector<Record>& db, const RecordStore& parsed) {
+                    db = toVector(parsed);
+                });
+            }
+            cerr << "Unknown layout " << layout << endl;
+            return EXIT_FAILURE;
+        }
+        if (argc < 3) {
+            cerr << "Please provide a database file" << endl;
+            return EXIT_FAILURE;
+        }
+        if (mode == "follow") {
+            return benchFollow(argv[2], argc > 3 ? static_cast<size_t>(stoul(argv[3])) : 300000,
+                               argc > 4 ? static_cast<size_t>(stoul(argv[4])) : 1000);
+        }
+        if (mode == "threads") {
+            unsigned maxThreads = argc > 3 ? static_cast<unsigned>(stoul(argv[3])) : thread::hardware_concurrency();
+            return benchThreads(argv[2], maxThreads > 0 ? maxThreads : 1);
+        }
+    } catch (exception& e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    cerr << "Unknown benchmark " << mode << endl;
+    return EXIT_FAILURE;
+}
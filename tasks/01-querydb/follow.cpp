@@ -0,0 +1,159 @@
+#include "follow.h"
+#include "dbparser.h"
+#include "delta.h"
+#include "mappedfile.h"
+#include <algorithm>
+#include <stdexcept>
+using namespace std;
+
+//64 bit FNV-1a hash of `text`
+static uint64_t checksum(string_view text)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (char c : text) {
+        h ^= static_cast<unsigned char>(c);
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+bool FollowedDatabase::open(const string& dataBaseName, unsigned threads)
+{
+    this->dataBaseName = dataBaseName;
+    this->threads = threads;
+    return loadAll();
+}
+
+bool FollowedDatabase::loadAll()
+{
+    //Take the stamp before reading, so a change made while parsing is picked up by the next reload
+    SourceStamp now;
+    MappedFile file;
+    if (!sourceStamp(dataBaseName, now) || !file.open(dataBaseName)) {
+        return false;
+    }
+    string_view text = file.view();
+    deltaStamp = SourceStamp();
+    sourceStamp(deltaFileName(dataBaseName), deltaStamp);
+
+    RecordStore loaded;
+    parseDatabaseParallel(text, loaded, threads);
+    mergeDeltas(dataBaseName, loaded);
+    db = move(loaded);
+
+    stamp = now;
+    lines = 0;
+    markTail(text, 0);
+    sids.clear();
+    sidRecords = 0;
+    addSids();
+    parsed = text.size();
+    return true;
+}
+
+void FollowedDatabase::markTail(string_view text, size_t searchFrom)
+{
+    size_t last = lastRecordTag(text.substr(searchFrom));
+    size_t offset = last == string_view::npos ? searchFrom : searchFrom + last;
+    lines += static_cast<uint64_t>(count(text.begin() + searchFrom, text.begin() + offset, '\n'));
+
+    //The last record only counts if it has a student ID (see parseDatabase), so see if it made it into db
+    RecordStore tail;
+    parseDatabase(text.substr(offset), tail, lines);
+
+    tailOffset = offset;
+    tailRecords = tail.size();
+    tailChecksum = checksum(text.substr(offset));
+    end = text.size();
+}
+
+void FollowedDatabase::addSids()
+{
+    const auto& column = db.sidColumn();
+    size_t before = db.size() - tailRecords;
+    sids.reserve(before);
+    for (; sidRecords < before; sidRecords++) {
+        sids.insert(column[sidRecords]);
+    }
+}
+
+FollowedDatabase::Change FollowedDatabase::reload()
+{
+    SourceStamp now;
+    if (!sourceStamp(dataBaseName, now)) {
+        throw runtime_error("Cannot open file " + dataBaseName);
+    }
+    parsed = 0;
+
+    //Any change to the delta log may touch any record
+    SourceStamp deltasNow;
+    sourceStamp(deltaFileName(dataBaseName), deltasNow);
+    if (deltasNow.size != deltaStamp.size || deltasNow.mtime != deltaStamp.mtime) {
+        if (!loadAll()) {
+            throw runtime_error("Cannot open file " + dataBaseName);
+        }
+        return RELOADED;
+    }
+
+    if (now.size == stamp.size && now.mtime == stamp.mtime) {
+        return UNCHANGED;
+    }
+
+    //Changed without growing, so it was not an append
+    if (now.size <= stamp.size) {
+        if (!loadAll()) {
+            throw runtime_error("Cannot open file " + dataBaseName);
+        }
+        return RELOADED;
+    }
+
+    MappedFile file;
+    if (!file.open(dataBaseName)) {
+        throw runtime_error("Cannot open file " + dataBaseName);
+    }
+    string_view text = file.view();
+
+    //Anything before the last record we read must be as it was
+    if (text.size() < end || checksum(text.substr(tailOffset, end - tailOffset)) != tailChecksum) {
+        if (!loadAll()) {
+            throw runtime_error("Cannot open file " + dataBaseName);
+        }
+        return RELOADED;
+    }
+
+    //Only parse whole lines - the writer may be part way through the last one
+    size_t lastNewline = text.rfind('\n');
+    size_t newEnd = lastNewline == string_view::npos ? 0 : lastNewline + 1;
+    if (newEnd <= end) {
+        stamp = now;
+        return UNCHANGED;
+    }
+    text = text.substr(0, newEnd);
+
+    //The last record may have been incomplete, so it is parsed again along with the new ones
+    RecordStore added;
+    parseDatabase(text.substr(tailOffset), added, lines);
+    if (deltaStamp.size > 0) {
+        //The last record was parsed again, so its changes are applied again
+        mergeDeltas(dataBaseName, added);
+    }
+    db.truncate(db.size() - tailRecords);
+
+    //A student already loaded has been moved to the end (see recordpatch.h), leaving a blank where it was
+    //(the last record was not yet in `sids`, so finding it again is no sign of a move)
+    for (int sid : added.sidColumn()) {
+        if (sids.count(sid) > 0) {
+            if (!loadAll()) {
+                throw runtime_error("Cannot open file " + dataBaseName);
+            }
+            return RELOADED;
+        }
+    }
+    db.append(added);
+
+    parsed = text.size() - tailOffset;
+    stamp = now;
+    markTail(text, tailOffset);
+    addSids();
+    return APPENDED;
+}
@@ -0,0 +1,69 @@
+#ifndef FOLLOW_H
+#define FOLLOW_H
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+#include "recordstore.h"
+#include "snapshot.h"
+
+/*
+ * A database that is kept up to date as records are appended to it (as addrecord does)
+ *
+ * After the first full load, only the position and a checksum of the last record in the file are
+ * remembered. A reload checks that this record is unchanged and then parses from it to the end of
+ * the file, so picking up new records costs about as much as the records themselves. The student IDs
+ * already loaded are kept in a set, so a record moved to the end is noticed without going over them all.
+ * If the last record has changed, the file has been changed without growing (e.g. updaterecord changed
+ * a record in place), a record already loaded has been moved to the end, or the delta log has changed,
+ * the whole file is loaded again.
+ */
+class FollowedDatabase {
+public:
+    //What reload found
+    enum Change {
+        UNCHANGED,      //Nothing new
+        APPENDED,       //Records were added at the end (the records already in `db` are unchanged)
+        RELOADED        //The file was rewritten, so every record was loaded again
+    };
+
+    //Records are loaded into `db`
+    explicit FollowedDatabase(RecordStore& db) : db(db) {}
+
+    //Load the whole of `dataBaseName`, parsing on `threads` threads (see parseDatabaseParallel)
+    //Returns false if it cannot be opened. Throws std::runtime_error if the data is malformed
+    bool open(const std::string& dataBaseName, unsigned threads = 1);
+
+    //Pick up any change to the database since the last load
+    //Throws std::runtime_error if the data is malformed or the file can no longer be read
+    Change reload();
+
+    //Number of bytes parsed by the last open or reload
+    uint64_t bytesParsed() const { return parsed; }
+
+private:
+    //Load the whole file
+    bool loadAll();
+
+    //Remember the last record of `text` (the file as far as it has been parsed)
+    void markTail(std::string_view text, size_t searchFrom);
+
+    //Add the student IDs of the records in `db` before the last record to `sids`
+    void addSids();
+
+    RecordStore& db;
+    std::string dataBaseName;
+    unsigned threads = 1;
+
+    SourceStamp stamp;              //The file when it was last read
+    SourceStamp deltaStamp;         //Its delta log (see delta.h) when it was last read, all zero if there was none
+    uint64_t end = 0;               //Bytes of the file that have been parsed (whole lines only)
+    uint64_t lines = 0;             //Lines before `tailOffset`
+    uint64_t tailOffset = 0;        //Start of the last record in the file
+    uint64_t tailChecksum = 0;      //Checksum of the text from tailOffset to end
+    size_t tailRecords = 0;         //Records in `db` that came from that text (0 or 1)
+    std::unordered_set<int> sids;   //Student IDs of the first `sidRecords` records in `db`
+    size_t sidRecords = 0;          //Records before the last one, whose student IDs are in `sids`
+    uint64_t parsed = 0;
+};
+
+#endif // FOLLOW_H
@@ -0,0 +1,187 @@
+#include "gradestats.h"
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GRADESTATS_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+//Running totals over one module's grades
+struct ColumnSummary {
+    double sum = 0;
+    float min = 0;
+    float max = 0;
+    size_t passed = 0;
+    array<size_t, GRADE_BUCKETS> histogram{};
+};
+
+//Histogram bucket of grade `g`
+static size_t bucketOf(float g)
+{
+    float b = std::min(std::max(g * 0.1f, 0.0f), float(GRADE_BUCKETS - 1));
+    return static_cast<size_t>(b);
+}
+
+//Summarise `n` grades (n > 0) one at a time
+static void summarizeScalar(const float* grades, size_t n, float passMark, ColumnSummary& s)
+{
+    s.min = s.max = grades[0];
+    for (size_t i = 0; i < n; i++) {
+        float g = grades[i];
+        s.sum += g;
+        s.min = std::min(s.min, g);
+        s.max = std::max(s.max, g);
+        s.passed += g >= passMark;
+        s.histogram[bucketOf(g)]++;
+    }
+}
+
+#ifdef GRADESTATS_SSE2
+
+//Summarise `n` grades (n > 0) four at a time, finishing any left over with the scalar loop
+static void summarizeSimd(const float* grades, size_t n, float passMark, ColumnSummary& s)
+{
+    size_t blocks = n / 4;
+    if (blocks == 0) {
+        summarizeScalar(grades, n, passMark, s);
+        return;
+    }
+
+    //Number of set bits in a 4 bit mask
+    static const int bitCount[16] = {0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4};
+
+    //The sum is kept in doubles, so millions of grades add up without losing precision
+    __m128d sumLow = _mm_setzero_pd();
+    __m128d sumHigh = _mm_setzero_pd();
+    __m128 lowest = _mm_loadu_ps(grades);
+    __m128 highest = lowest;
+    const __m128 pass = _mm_set1_ps(passMark);
+    const __m128 tenth = _mm_set1_ps(0.1f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 lastBucket = _mm_set1_ps(float(GRADE_BUCKETS - 1));
+    alignas(16) int32_t buckets[4];
+
+    for (size_t b = 0; b < blocks; b++) {
+        __m128 v = _mm_loadu_ps(grades + b * 4);
+        sumLow = _mm_add_pd(sumLow, _mm_cvtps_pd(v));
+        sumHigh = _mm_add_pd(sumHigh, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+        lowest = _mm_min_ps(lowest, v);
+        highest = _mm_max_ps(highest, v);
+        s.passed += bitCount[_mm_movemask_ps(_mm_cmpge_ps(v, pass))];
+
+        //Bucket numbers are worked out together, but each count has to be added on its own
+        __m128 scaled = _mm_min_ps(_mm_max_ps(_mm_mul_ps(v, tenth), zero), lastBucket);
+        _mm_store_si128(reinterpret_cast<__m128i*>(buckets), _mm_cvttps_epi32(scaled));
+        s.histogram[buckets[0]]++;
+        s.histogram[buckets[1]]++;
+        s.histogram[buckets[2]]++;
+        s.histogram[buckets[3]]++;
+    }
+
+    //Combine the four lanes
+    alignas(16) double sums[4];
+    alignas(16) float lows[4];
+    alignas(16) float highs[4];
+    _mm_store_pd(sums, sumLow);
+    _mm_store_pd(sums + 2, sumHigh);
+    _mm_store_ps(lows, lowest);
+    _mm_store_ps(highs, highest);
+    s.sum += sums[0] + sums[1] + sums[2] + sums[3];
+    s.min = std::min(std::min(lows[0], lows[1]), std::min(lows[2], lows[3]));
+    s.max = std::max(std::max(highs[0], highs[1]), std::max(highs[2], highs[3]));
+
+    //The last few grades
+    for (size_t i = blocks * 4; i < n; i++) {
+        float g = grades[i];
+        s.sum += g;
+        s.min = std::min(s.min, g);
+        s.max = std::max(s.max, g);
+        s.passed += g >= passMark;
+        s.histogram[bucketOf(g)]++;
+    }
+}
+
+#else
+
+//No SIMD instructions to use on this processor
+static void summarizeSimd(const float* grades, size_t n, float passMark, ColumnSummary& s)
+{
+    summarizeScalar(grades, n, passMark, s);
+}
+
+#endif
+
+//Middle value of `n` grades (n > 0). The grades are reordered
+static float median(float* grades, size_t n)
+{
+    float* middle = grades + n / 2;
+    nth_element(grades, middle, grades + n);
+    if (n % 2 == 1) {
+        return *middle;
+    }
+    //Even count - the mean of the two middle values (the lower one is the largest of the first half)
+    float lower = *max_element(grades, middle);
+    return (lower + *middle) / 2;
+}
+
+vector<ModuleStats> moduleStatistics(const RecordStore& db, float passMark, bool vectorized)
+{
+    size_t modules = moduleDictionary().size();
+
+    //Gather the grades of each module into one contiguous column (a counting sort on module ID):
+    //count them, then give each module its own run of one array, then copy the grades in
+    vector<size_t> start(modules + 1, 0);
+    for (size_t n = 0; n < db.size(); n++) {
+        RecordView r = db[n];
+        size_t pairs = std::min(r.enrollments.size(), r.grades.size());
+        for (size_t i = 0; i < pairs; i++) {
+            start[r.enrollments[i] + 1]++;
+        }
+    }
+    for (size_t m = 0; m < modules; m++) {
+        start[m + 1] += start[m];
+    }
+    vector<float> columns(start[modules]);
+    vector<size_t> next(start.begin(), start.end() - 1);
+    for (size_t n = 0; n < db.size(); n++) {
+        RecordView r = db[n];
+        size_t pairs = std::min(r.enrollments.size(), r.grades.size());
+        for (size_t i = 0; i < pairs; i++) {
+            columns[next[r.enrollments[i]]++] = r.grades[i];
+        }
+    }
+
+    //Reduce each column
+    vector<ModuleStats> stats;
+    for (size_t m = 0; m < modules; m++) {
+        size_t count = start[m + 1] - start[m];
+        if (count == 0) {
+            continue;
+        }
+        float* grades = columns.data() + start[m];
+        ColumnSummary s;
+        if (vectorized) {
+            summarizeSimd(grades, count, passMark, s);
+        } else {
+            summarizeScalar(grades, count, passMark, s);
+        }
+
+        ModuleStats result;
+        result.module = static_cast<ModuleId>(m);
+        result.count = count;
+        result.mean = s.sum / count;
+        result.min = s.min;
+        result.max = s.max;
+        result.median = median(grades, count);
+        result.passRate = double(s.passed) / count;
+        result.histogram = s.histogram;
+        stats.push_back(result);
+    }
+
+    sort(stats.begin(), stats.end(), [](const ModuleStats& a, const ModuleStats& b) {
+        return moduleName(a.module) < moduleName(b.module);
+    });
+    return stats;
+}
@@ -0,0 +1,31 @@
+#ifndef GRADESTATS_H
+#define GRADESTATS_H
+#include <array>
+#include <cstddef>
+#include <vector>
+#include "moduledict.h"
+#include "recordstore.h"
+
+//Number of histogram buckets: 0-9, 10-19 ... 80-89 and 90-100
+const size_t GRADE_BUCKETS = 10;
+
+//Statistics of every grade given in one module
+struct ModuleStats {
+    ModuleId module = 0;
+    size_t count = 0;
+    double mean = 0;
+    float min = 0;
+    float max = 0;
+    float median = 0;
+    double passRate = 0;    //Fraction of grades at or above the pass mark
+    std::array<size_t, GRADE_BUCKETS> histogram{};    //Grades below 0 count as 0-9, and above 100 as 90-100
+};
+
+//Functions
+
+//Work out the statistics of every module with at least one grade, in order of module code
+//Each enrollment is paired with the grade in the same position of the record (extra enrollments
+//or grades are ignored). Set `vectorized` to false to use plain loops instead of the SIMD kernels
+std::vector<ModuleStats> moduleStatistics(const RecordStore& db, float passMark, bool vectorized = true);
+
+#endif // GRADESTATS_H
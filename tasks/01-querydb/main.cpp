@@ -1,22 +1,48 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
-#include <sstream>
-#include <regex>
-#include <map>
+#include <algorithm>
+#include <chrono>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
 #include "testdb.h"
 
 #include "studentrecord.h"
+#include "dbparser.h"
+#include "follow.h"
+#include "gradestats.h"
+#include "mappedfile.h"
+#include "numparse.h"
+#include "recordstore.h"
+#include "recordwriter.h"
+#include "runstats.h"
+#include "snapshot.h"
+#include "delta.h"
+#include "sidindex.h"
 
 
 using namespace std;
 
 //See bottom of main
 int findArg(int argc, char *argv[], string pattern);
+void printQuery(const RecordView& r, int argc, char* argv[]);
+void printQuery(RecordWriter& out, const RecordView& r, int argc, char* argv[]);
+
+//Outcome of answering a list of student IDs (see answerBatch)
+struct BatchResult {
+    size_t ids = 0;         //IDs read
+    size_t found = 0;       //IDs with a record
+    size_t invalid = 0;     //Entries that were not IDs
+};
+BatchResult answerBatch(istream& ip, RecordWriter& out, const RecordStore& db, const Snapshot& snapshot, int argc, char* argv[]);
 
 std::vector<Record> db;
 
+//How often -follow looks for new records
+const int FOLLOW_INTERVAL_MS = 100;
+
 /*
  *
  * The user can pass the following parameters to this application:
@@ -29,6 +55,25 @@ std::vector<Record> db;
  *                                 -n       Just display the name
  *                                 -g       Just display the mode codes and grades
  *                                 -p       Just display the phone number
+ * -stats                       Writes timings and resource use to stderr as one line of key=value pairs: the time
+ *                              spent in each phase (open, parse, query, output), the parse rate in bytes and
+ *                              records per second, the peak resident memory, the number of heap allocations and
+ *                              where the records came from (load_source)
+ * -asyncoutput                 Writes the output of -showAll and -sids from a separate thread
+ * -threads <n>                 Parses the database on <n> threads (0 = one per processor, default 1)
+ * -legacyparse                 Loads the database with the original getline/regex parser
+ * -buildsnapshot               Creates <database file>.snap, a compiled copy of the database that later runs
+ *                              load instead of parsing the text. It is rebuilt automatically once out of date
+ * -buildindex                  Creates <database file>.idx, an index from student ID to record position that
+ *                              -sid uses to read one record. addrecord and updaterecord keep it up to date
+ * -modulestats [-passmark <g>] Writes statistics of the grades in every module as CSV: the number of grades,
+ *                              mean, minimum, maximum, median, the fraction at or above the pass mark <g>
+ *                              (default 40) and how many fall in each band of 10 marks
+ * -sids <file> [-n|-g|-p]      Writes the record for every student ID listed in <file> (- for standard input),
+ *                              one or more per line, in the order given. The database is loaded once for the
+ *                              whole list, and each record is displayed as -sid would display it
+ * -follow                      Keeps running, and writes each record as it is appended to the database.
+ *                              With -sid, waits until that student has been added instead
  *
  * ****************
  * *** EXAMPLES ***
@@ -94,152 +139,145 @@ int main(int argc, char *argv[])
         cout << "Please proviude a database with -db <filename>\n";
         return EXIT_FAILURE;
     }
-
-    //Open database file
-    ifstream ip(dataBaseName);
-    if (!ip.is_open()) {
-        cout << "Cannot open file " << dataBaseName << "\n";
-        return EXIT_FAILURE;
+    if (findArg(argc, argv, "-stats")) {
+        runStats().enable("querydb", "open");
     }
 
-    //Build data structure with all data contained within it
-    vector<Record> db;
-
-    //Locals used for navigating the database file
-    string nextLine;
-    string nextStr;
-    int recordNumber = -1;
-    Record nextRecord;
-    stringstream moduleCodes;
-    stringstream moduleGrades;
-    string moduleCode = "";
-    string moduleGrade = "";
-
-    //Locals used for the "state machine"
-
-    //This is just an integer type, where START=0, NEXTTAG=1, RECORD=2 etc.....
-    enum state_t {START, NEXTTAG, RECORD, SID, NAME, ENROLLMENTS, GRADES, PHONE};
-    state_t state = START;
-
-    //"Look up table" - maps a string to an integer. e.g. nextState["#SID"] returns 1
-    map<string,state_t> nextState = {
-        {"#RECORD", RECORD},
-        {"#SID", SID},
-        {"#NAME", NAME},
-        {"#ENROLLMENTS", ENROLLMENTS},
-        {"#GRADES", GRADES},
-        {"#PHONE", PHONE}
-    };
-
-
-    //*********
-    //Main loop
-    //*********
-    try
-    {
-        //Read the next line (loop exits on end of file)
-        while (getline(ip, nextLine))
-        {
-            // Remove leading spaces
-            // Replace "start of line (^) followed by any number of trailing spaces (' +')" with with nothing ""
-            string nextStr = regex_replace(nextLine, regex("^ +"), "");
-
-            //Skip blank lines
-            if (nextStr.empty()) continue;
-
-            //Enter "state machine" - study this carefully - it's a really useful "pattern"
-            switch (state)
-            {
-            case START:
-                //We begin here - the first non-blank line MUST start with "#RECORD"
-                if (nextStr != "#RECORD") {
-                    //The first list MUST simply read #RECORD
-                    throw("Expected #RECORD as first tag");
-                }
-                //Next time around the loop, use the RECORD state
-                state = RECORD;
-                recordNumber = 0;
-                break;
-            case RECORD: //Everytime a #RECORD is found, we enter this state on the next line
-                //Except for the first occasion, save the record we have just finished reading
-                if (recordNumber > 0) {
-                    //For each new #RECORD tag, store the previous
-                    db.push_back(nextRecord);
-                    //Reset the nextRecord to defaults
-                    nextRecord = {0};
-                }
-                //Increment the record number
-                recordNumber++;
-                //Fall through into SEEK (note the break is missing) - #RECORD is always followed by a tag
-            case NEXTTAG:
-                //nextString should contain a tag at this point - will throw an exception if not
-                state = nextState[nextStr];
-                break;
-            case SID:
-                //nextStr should contain a string representation of an integer. If not, an exception will be thrown
-                nextRecord.SID = stoi(nextStr);
-                //Now look for the next tag
-                state = NEXTTAG;
-                break;
-            case NAME:
-                //nextStr should contain a name
-                nextRecord.name = nextStr;
-                state = NEXTTAG;
-                break;
-            case ENROLLMENTS:
-                //nextString should be a list of module codes separated by spaces
-                moduleCodes = stringstream(nextStr);
-                //Extract each separate module code
-                while (moduleCodes.eof() == false) {
-                    moduleCodes >> moduleCode;
-                    //If the prevous line did not succeed, we've probably read a space on the end
-                    if (moduleCodes.fail()) {
-                        break;
-                    }
-                    //Add the module string to the `enrollments` vector
-                    nextRecord.enrollments.push_back(moduleCode);
-                }
-                state = NEXTTAG;
-                break;
-            case GRADES:
-                //nextString should contain a list of grades, separated by spaces
-                moduleGrades = stringstream(nextStr);
-                //Extract each separate module grade as a float
-                while (moduleGrades.eof() == false) {
-                    moduleGrades >> moduleGrade;
-                    if (moduleGrades.fail()) {
-                        break;
-                    }
-                    //Convert to float, and save in the grades vector
-                    nextRecord.grades.push_back(stof(moduleGrade)); //This can throw an exception
-                }
-                state = NEXTTAG;
-                break;
-
-            case PHONE:
-                //Next String should be a phone number (no spaces)
-                nextRecord.phone = nextStr;
-                state = NEXTTAG;
-                break;
-            } //End Switch
+    //Load the whole database into the db record store
+    //If an up to date snapshot exists, records are copied out of it on demand instead
+    RecordStore db;
+    Snapshot snapshot;
+    SidIndex index;
+    MappedFile streamFile;
+    FollowedDatabase followed(db);
+    bool follow = findArg(argc, argv, "-follow") > 0;
+    size_t loadBytes = 0;
+    string loadSource;
+
+    //Create the SID index if asked to
+    if (findArg(argc, argv, "-buildindex")) {
+        if (buildIndex(dataBaseName)) {
+            cout << "Index written to " << indexFileName(dataBaseName) << "\n";
+        } else {
+            cerr << "Unable to write index " << indexFileName(dataBaseName) << endl;
+        }
+    }
 
-        } //End while
+    //Is a single record all that is wanted?
+    bool sidOnly = findArg(argc, argv, "-sid") && !findArg(argc, argv, "-showAll") && !findArg(argc, argv, "-buildsnapshot")
+                   && !findArg(argc, argv, "-modulestats");
 
-        //The loop above may exit before pushing the last record into db
-        if (nextRecord.SID > 0) {
-            db.push_back(nextRecord);
+    //Number of threads used to parse the text (0 = one per processor)
+    unsigned threads = 1;
+    p = findArg(argc, argv, "-threads");
+    if (p) {
+        int count = -1;
+        if (p == argc - 1) {
+            cout << "Please provide a number of threads after -threads" << endl;
+            return EXIT_FAILURE;
+        }
+        NumberResult result = parseInt(argv[p + 1], count);
+        if (!result.ok() || count < 0) {
+            cout << "Please provide a number of threads after -threads" << endl;
+            if (!result.ok()) {
+                cerr << numberErrorMessage(result, argv[p + 1], "number of threads") << endl;
+            }
+            return EXIT_FAILURE;
         }
+        threads = static_cast<unsigned>(count);
+    }
 
-        //Close the file - we are done reading it. Everything is now in the db vector
-        ip.close();
+    if (follow) {
+        //Parse the text, remembering where it ends so that appended records can be picked up later
+        loadSource = "follow";
+        runStats().phase("parse");
+        try {
+            if (!followed.open(dataBaseName, threads)) {
+                cout << "Cannot open file " << dataBaseName << "\n";
+                return EXIT_FAILURE;
+            }
+        } catch (exception& e) {
+            cout << "Error reading data" << endl;
+            cerr << e.what() << endl;
+            return EXIT_FAILURE;
+        }
+        loadBytes = static_cast<size_t>(followed.bytesParsed());
+        runStats().parsed(loadBytes, db.size());
+    } else if (findArg(argc, argv, "-legacyparse")) {
+        //Original getline + regex state machine (kept for comparison)
+        loadSource = "legacy";
+        ifstream ip(dataBaseName);
+        if (!ip.is_open()) {
+            cout << "Cannot open file " << dataBaseName << "\n";
+            return EXIT_FAILURE;
+        }
+        ip.seekg(0, ios::end);
+        loadBytes = static_cast<size_t>(ip.tellg());
+        ip.seekg(0, ios::beg);
+        runStats().phase("parse");
+        try {
+            vector<Record> records;
+            parseDatabaseLegacy(ip, records);
+            ip.close();
+            db.reserve(records.size());
+            for (const Record& r : records) {
+                db.add(r);
+            }
+            mergeDeltas(dataBaseName, db);
+            runStats().parsed(loadBytes, db.size());
+        } catch (exception& e) {
+            //Many things could go wrong, so we catch them here, tell the user and close the file (tidy up)
+            ip.close();
+            cout << "Error reading data" << endl;
+            cerr << e.what() << endl;
+            return EXIT_FAILURE;
+        }
+    } else if (!hasDeltas(dataBaseName) && snapshot.open(dataBaseName)) {
+        //Nothing to parse - the snapshot is paged in as records are used
+        //(not while there are changes in the delta log, which loadDatabase applies to the whole store)
+        loadSource = "snapshot";
+    } else if (sidOnly && (index.open(dataBaseName)
+                           || (indexExists(dataBaseName) && buildIndex(dataBaseName) && index.open(dataBaseName)))) {
+        //The SID index says where the record is, so only that record is read (a stale index is rebuilt first)
+        loadSource = "index";
+    } else if (sidOnly) {
+        //Only one record is wanted, so it is found by scanning the file below rather than loading everything
+        loadSource = "stream";
+        if (!streamFile.open(dataBaseName)) {
+            cout << "Cannot open file " << dataBaseName << "\n";
+            return EXIT_FAILURE;
+        }
+    } else {
+        //Map the file into memory and parse it in place (rebuilding the snapshot if it was out of date)
+        loadSource = "text";
+        SourceStamp stamp;
+        bool haveStamp = sourceStamp(dataBaseName, stamp);
+        loadBytes = haveStamp ? static_cast<size_t>(stamp.size) : 0;
+        runStats().phase("parse");
+        try {
+            if (!loadDatabase(dataBaseName, db, threads)) {
+                cout << "Cannot open file " << dataBaseName << "\n";
+                return EXIT_FAILURE;
+            }
+        } catch (exception& e) {
+            cout << "Error reading data" << endl;
+            cerr << e.what() << endl;
+            return EXIT_FAILURE;
+        }
+        runStats().parsed(loadBytes, db.size());
+
+        //Create the snapshot if asked to - later runs will then skip the parse
+        if (haveStamp && findArg(argc, argv, "-buildsnapshot")) {
+            if (writeSnapshot(dataBaseName, db, stamp)) {
+                cout << "Snapshot written to " << snapshotFileName(dataBaseName) << "\n";
+            } else {
+                cerr << "Unable to write snapshot " << snapshotFileName(dataBaseName) << endl;
+            }
+        }
+    }
 
-    }  catch (exception e) {
-        //Many things could go wrong, so we catch them here, tell the user and close the file (tidy up)
-        ip.close();
-        cout << "Error reading data" << endl;
-        cerr << e.what() << endl;
-        return EXIT_FAILURE;
-    } //end try
+    runStats().set("load_source", loadSource);
+    runStats().set("load_records", snapshot.isOpen() ? snapshot.size() : db.size());
 
 
     // IF WE MADE IT THIS FAR, THE DATABASE FILE WAS SUCCESSFULLY READ!
@@ -247,11 +285,75 @@ int main(int argc, char *argv[])
     //*******************************
     //Option to display data ALL DATA
     //*******************************
+    bool asyncOutput = findArg(argc, argv, "-asyncoutput") > 0;
     if (findArg(argc, argv, "-showAll")) {
-        for (Record& r : db) {
-            printRecord(r);
-            cout << endl;
+        runStats().phase("output");
+        //Records are formatted into a buffer that is written out in large blocks
+        RecordWriter out(cout, RecordWriter::BLOCK_SIZE, asyncOutput);
+        for (size_t n = 0; n < snapshot.size(); n++) {
+            Record r = snapshot.record(n);
+            out.writeRecord(viewOf(r));
+            out << '\n';
+        }
+        for (size_t n = 0; n < db.size(); n++) {
+            out.writeRecord(db[n]);
+            out << '\n';
+        }
+    }
+
+    //*******************************************
+    //Option to display statistics of each module
+    //*******************************************
+    if (findArg(argc, argv, "-modulestats")) {
+        float passMark = 40;
+        p = findArg(argc, argv, "-passmark");
+        if (p) {
+            NumberResult result = p < argc - 1 ? parseFloat(argv[p + 1], passMark) : NumberResult{NumberError::EMPTY, 0};
+            if (!result.ok()) {
+                cout << "Please provide a grade after -passmark" << endl;
+                if (p < argc - 1) {
+                    cerr << numberErrorMessage(result, argv[p + 1], "pass mark") << endl;
+                }
+                return EXIT_FAILURE;
+            }
+        }
+
+        //Every record is needed, so records in the snapshot are copied out of it
+        runStats().phase("query");
+        vector<ModuleStats> stats;
+        try {
+            if (snapshot.isOpen() && db.empty()) {
+                snapshot.loadAll(db);
+            }
+            stats = moduleStatistics(db, passMark);
+        } catch (exception& e) {
+            cout << "Error reading data" << endl;
+            cerr << e.what() << endl;
+            return EXIT_FAILURE;
+        }
+
+        runStats().phase("output");
+        cout << "module,count,mean,min,max,median,pass_rate";
+        for (size_t b = 0; b < GRADE_BUCKETS; b++) {
+            cout << "," << b * 10 << "-" << (b == GRADE_BUCKETS - 1 ? 100 : b * 10 + 9);
+        }
+        cout << "\n";
+        for (const ModuleStats& m : stats) {
+            cout << moduleName(m.module) << "," << m.count << "," << m.mean << "," << m.min << "," << m.max << ","
+                 << m.median << "," << m.passRate;
+            for (size_t n : m.histogram) {
+                cout << "," << n;
+            }
+            cout << "\n";
+        }
+        cout << flush;
+
+        size_t grades = 0;
+        for (const ModuleStats& m : stats) {
+            grades += m.count;
         }
+        runStats().set("stats_modules", stats.size());
+        runStats().set("stats_grades", grades);
     }
 
     //**************************************************************
@@ -271,56 +373,215 @@ int main(int argc, char *argv[])
         string strID = argv[p + 1];
 
         // Try to convert to a number
-        int sid;
-        try
+        int sid = 0;
+        NumberResult result = parseInt(strID, sid);
+        if (!result.ok())
         {
-            sid = stoi(strID);
+            cout << "Please provide a student ID as an integer" << endl;
+            cerr << numberErrorMessage(result, strID, "student ID") << endl;
+            return EXIT_FAILURE;
+        }
+
+        //The search is timed as the query, and displaying what it found as the output
+        runStats().phase("query");
+        auto show = [&](const RecordView& r) {
+            runStats().phase("output");
+            printQuery(r, argc, argv);
+        };
 
+        try
+        {
             // Search for the record with this ID
             bool found = false;
-            for (Record& r : db)
-            {
-                if (r.SID == sid)
-                {
-                    
-                    if (findArg(argc, argv, "-n"))
-                    {
-                        cout << "Name: " << r.name << endl;
+            if (index.isOpen()) {
+                //Read just the record the index points at
+                RecordSpan span;
+                Record r;
+                if (index.find(sid, span)) {
+                    //An entry that leads to another student, or to no record at all, means the index is
+                    //damaged, so the file is scanned for the record instead (below)
+                    try {
+                        found = readRecordAt(dataBaseName, span, r) && r.SID == sid;
+                    } catch (runtime_error&) {
+                        found = false;
                     }
-                    if (findArg(argc, argv, "-g"))
-                    {
-                        cout << "Module Codes and Grades:" << endl;
-                        for (size_t i = 0; i < r.enrollments.size(); ++i)
-                        {
-                            cout << r.enrollments[i] << ": " << r.grades[i] << endl;
-                        }
+                    runStats().parsed(span.length, found ? 1 : 0);
+                    if (!found && !streamFile.open(dataBaseName)) {
+                        cout << "Cannot open file " << dataBaseName << "\n";
+                        return EXIT_FAILURE;
                     }
-                    else if (findArg(argc, argv, "-p"))
-                    {
-                        cout << "Phone: " << r.phone << endl;
+                }
+                try {
+                    if (found) {
+                        mergeDeltas(dataBaseName, r);
                     }
-                    else {
-                        printRecord(r);
+                } catch (runtime_error& e) {
+                    cout << "Error reading data" << endl;
+                    cerr << e.what() << endl;
+                    return EXIT_FAILURE;
+                }
+                if (found) {
+                    show(viewOf(r));
+                }
+            }
+            if (streamFile.isOpen()) {
+                //Parse record by record, stopping at the first match
+                Record r;
+                size_t scanned = 0;
+                try {
+                    found = findRecord(streamFile, sid, r, &scanned);
+                    if (found) {
+                        mergeDeltas(dataBaseName, r);
                     }
-
+                } catch (runtime_error& e) {
+                    cout << "Error reading data" << endl;
+                    cerr << e.what() << endl;
+                    return EXIT_FAILURE;
+                }
+                runStats().parsed(scanned, found ? 1 : 0);
+                if (found) {
+                    show(viewOf(r));
+                }
+            }
+            if (snapshot.isOpen()) {
+                //The snapshot has a sorted SID index, so only the matching record is read
+                long long record = snapshot.find(sid);
+                if (record >= 0) {
+                    Record r = snapshot.record(static_cast<size_t>(record));
+                    show(viewOf(r));
                     found = true;
-                    break;
                 }
             }
+            long long n = db.find(sid);
+            if (n >= 0) {
+                show(db[static_cast<size_t>(n)]);
+                found = true;
+            }
             //if the SID is not found
-            if (!found)
+            if (!found && follow)
+            {
+                cout << "No record with SID=" << strID << " yet - waiting for it to be added" << endl;
+            }
+            else if (!found)
             {
                 cout << "No record with SID=" << strID << " was found" << endl;
             }
         }
         catch (exception& e)
         {
-            cout << "Please provide a student ID as an integer" << endl;
+            cout << "Error reading data" << endl;
+            cerr << e.what() << endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    //**************************************************************
+    //Option to display the records for a list of student IDs
+    //**************************************************************
+    int batchArg = findArg(argc, argv, "-sids");
+    if (batchArg)
+    {
+        if (batchArg == argc - 1)
+        {
+            cerr << "Please provide a file of student IDs (or - for standard input) after -sids" << endl;
+            return EXIT_FAILURE;
+        }
+
+        string sidFile = argv[batchArg + 1];
+        //Lookups and output are interleaved, so they are timed together
+        runStats().phase("batch");
+        BatchResult batch;
+        try
+        {
+            RecordWriter out(cout, RecordWriter::BLOCK_SIZE, asyncOutput);
+            if (sidFile == "-")
+            {
+                batch = answerBatch(cin, out, db, snapshot, argc, argv);
+            }
+            else
+            {
+                ifstream ip(sidFile);
+                if (!ip.is_open())
+                {
+                    cout << "Cannot open file " << sidFile << "\n";
+                    return EXIT_FAILURE;
+                }
+                batch = answerBatch(ip, out, db, snapshot, argc, argv);
+                ip.close();
+            }
+        }
+        catch (exception& e)
+        {
+            cout << "Error reading data" << endl;
+            cerr << e.what() << endl;
+            return EXIT_FAILURE;
+        }
+
+        runStats().set("batch_ids", batch.ids);
+        runStats().set("batch_found", batch.found);
+        runStats().set("batch_invalid", batch.invalid);
+        if (batch.invalid > 0)
+        {
             return EXIT_FAILURE;
         }
     }
 
-    ip.close(); //Closed
+    //****************************************************************
+    //Option to keep running and display records as they are appended
+    //****************************************************************
+    if (follow) {
+        //With -sid, only that student is wanted, and only until it turns up
+        int sid = 0;
+        bool oneStudent = p && parseInt(argv[p + 1], sid).ok();
+        bool waiting = !oneStudent || db.find(sid) < 0;
+        size_t shown = db.size();
+        unsigned tailReloads = 0;
+        unsigned fullReloads = 0;
+        runStats().phase("follow");
+        while (waiting) {
+            this_thread::sleep_for(chrono::milliseconds(FOLLOW_INTERVAL_MS));
+
+            runStats().phase("reload");
+            FollowedDatabase::Change change;
+            try {
+                change = followed.reload();
+            } catch (exception& e) {
+                cout << "Error reading data" << endl;
+                cerr << e.what() << endl;
+                return EXIT_FAILURE;
+            }
+            if (change != FollowedDatabase::UNCHANGED) {
+                runStats().parsed(followed.bytesParsed(),
+                                  change == FollowedDatabase::APPENDED ? db.size() - min(shown, db.size()) : db.size());
+                if (change == FollowedDatabase::APPENDED) {
+                    runStats().set("reloads_tail", ++tailReloads);
+                } else {
+                    runStats().set("reloads_full", ++fullReloads);
+                }
+            }
+            runStats().phase("follow");
+            if (change == FollowedDatabase::UNCHANGED) {
+                continue;
+            }
+
+            //A rewritten file may hold different records anywhere, so it is searched again from the top
+            RecordWriter out(cout);
+            if (change == FollowedDatabase::RELOADED) {
+                out << "Database " << dataBaseName << " was rewritten and has been reloaded\n";
+                shown = oneStudent ? 0 : db.size();
+            }
+            for (; shown < db.size() && waiting; shown++) {
+                RecordView r = db[shown];
+                if (!oneStudent) {
+                    out.writeRecord(r);
+                    out << '\n';
+                } else if (r.SID == sid) {
+                    printQuery(out, r, argc, argv);
+                    waiting = false;
+                }
+            }
+        }
+    }
 
     return EXIT_SUCCESS;
 }
@@ -338,3 +599,105 @@ int findArg(int argc, char* argv[], string pattern)
     }
     return 0;
 }
+
+//Function to answer every student ID read from `ip` (see -sids), in the order they are given
+//Entries that are not IDs are reported on cerr and skipped
+BatchResult answerBatch(istream& ip, RecordWriter& out, const RecordStore& db, const Snapshot& snapshot, int argc, char* argv[])
+{
+    BatchResult result;
+
+    //Position of the first record with each ID, built once for the whole list
+    //(the snapshot has its own sorted index)
+    unordered_map<int, size_t> positions;
+    if (!snapshot.isOpen()) {
+        positions = indexBySid(db);
+    }
+
+    string line;
+    size_t lineNumber = 0;
+    while (getline(ip, line))
+    {
+        lineNumber++;
+        string_view text = line;
+        size_t pos = 0;
+        while (true)
+        {
+            //IDs are separated by spaces, tabs or commas
+            pos = text.find_first_not_of(" \t,\r", pos);
+            if (pos == string_view::npos) {
+                break;
+            }
+            size_t end = min(text.find_first_of(" \t,\r", pos), text.size());
+            string_view strID = text.substr(pos, end - pos);
+            pos = end;
+
+            int sid = 0;
+            NumberResult parsed = parseInt(strID, sid);
+            if (!parsed.ok()) {
+                cerr << "Line " << lineNumber << ": " << numberErrorMessage(parsed, strID, "student ID") << endl;
+                result.invalid++;
+                continue;
+            }
+            result.ids++;
+
+            bool found = false;
+            if (snapshot.isOpen()) {
+                long long n = snapshot.find(sid);
+                if (n >= 0) {
+                    Record r = snapshot.record(static_cast<size_t>(n));
+                    printQuery(out, viewOf(r), argc, argv);
+                    found = true;
+                }
+            } else {
+                auto it = positions.find(sid);
+                if (it != positions.end()) {
+                    printQuery(out, db[it->second], argc, argv);
+                    found = true;
+                }
+            }
+            if (found) {
+                result.found++;
+            } else {
+                out << "No record with SID=" << strID << " was found\n";
+            }
+        }
+    }
+    out.flush();
+    return result;
+}
+
+//Function to display the parts of a record selected with -n, -g and -p (or all of it)
+void printQuery(const RecordView& r, int argc, char* argv[])
+{
+    RecordWriter out(cout);
+    printQuery(out, r, argc, argv);
+}
+
+void printQuery(RecordWriter& out, const RecordView& r, int argc, char* argv[])
+{
+    if (findArg(argc, argv, "-n"))
+    {
+        out << "Name: " << r.name << '\n';
+    }
+    if (findArg(argc, argv, "-g"))
+    {
+        out << "Module Codes and Grades:\n";
+        //Grades are paired with enrollments by position, and the last few modules may not have one yet
+        size_t graded = min(r.enrollments.size(), r.grades.size());
+        for (size_t i = 0; i < graded; ++i)
+        {
+            out << moduleName(r.enrollments[i]) << ": " << r.grades[i] << '\n';
+        }
+        for (size_t i = graded; i < r.enrollments.size(); ++i)
+        {
+            out << moduleName(r.enrollments[i]) << ": no grade\n";
+        }
+    }
+    else if (findArg(argc, argv, "-p"))
+    {
+        out << "Phone: " << r.phone << '\n';
+    }
+    else {
+        out.writeRecord(r);
+    }
+}
@@ -0,0 +1,339 @@
+#include "import.h"
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+#include <string_view>
+#include "numparse.h"
+#include "validate.h"
+using namespace std;
+
+//Columns of an import file
+enum Column { SID, NAME, PHONE, MODULECODES, GRADES, OTHER };
+
+static Column columnNamed(string name)
+{
+    for (char& c : name) {
+        c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+    }
+    if (name == "sid") return SID;
+    if (name == "name") return NAME;
+    if (name == "phone") return PHONE;
+    if (name == "modulecodes") return MODULECODES;
+    if (name == "grades") return GRADES;
+    return OTHER;
+}
+
+static runtime_error lineError(size_t line, const string& what)
+{
+    return runtime_error("Line " + to_string(line) + ": " + what);
+}
+
+//Split `text` into the words between spaces
+static vector<string> words(string_view text)
+{
+    vector<string> result;
+    size_t start = 0;
+    while (true) {
+        start = text.find_first_not_of(" \t", start);
+        if (start == string_view::npos) {
+            return result;
+        }
+        size_t end = min(text.find_first_of(" \t", start), text.size());
+        result.emplace_back(text.substr(start, end - start));
+        start = end;
+    }
+}
+
+//Store `value` in the field of `row` for `column` (without any spaces around it)
+static void setField(ImportRow& row, Column column, string value)
+{
+    size_t end = value.find_last_not_of(" \t");
+    value.erase(end == string::npos ? 0 : end + 1);
+    value.erase(0, value.find_first_not_of(" \t"));
+    switch (column) {
+    case SID: row.sid = move(value); break;
+    case NAME: row.name = move(value); break;
+    case PHONE: row.phone = move(value); break;
+    case MODULECODES: row.moduleCodes = words(value); break;
+    case GRADES: row.grades = words(value); break;
+    case OTHER: break;
+    }
+}
+
+//Split one CSV line into fields. Quoted fields may hold commas, and "" stands for a quote
+static vector<string> csvFields(string_view text, size_t line)
+{
+    vector<string> fields(1);
+    bool quoted = false;
+    for (size_t i = 0; i < text.size(); i++) {
+        char c = text[i];
+        if (quoted) {
+            if (c != '"') {
+                fields.back() += c;
+            } else if (i + 1 < text.size() && text[i + 1] == '"') {
+                fields.back() += '"';
+                i++;
+            } else {
+                quoted = false;
+            }
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == ',') {
+            fields.emplace_back();
+        } else {
+            fields.back() += c;
+        }
+    }
+    if (quoted) {
+        throw lineError(line, "unterminated quote");
+    }
+    return fields;
+}
+
+//Minimal reader for the one-level JSON objects of an import file
+class JsonLine {
+public:
+    JsonLine(string_view text, size_t line) : text(text), line(line) {}
+
+    ImportRow read()
+    {
+        ImportRow row;
+        row.line = line;
+        expect('{');
+        if (!accept('}')) {
+            do {
+                string key = readString();
+                expect(':');
+                Column column = columnNamed(key);
+                skipSpace();
+                if (peek() == '[') {
+                    vector<string> items = readArray();
+                    if (column == MODULECODES) {
+                        row.moduleCodes = move(items);
+                    } else if (column == GRADES) {
+                        row.grades = move(items);
+                    } else if (column != OTHER) {
+                        throw error("\"" + key + "\" cannot be a list");
+                    }
+                } else {
+                    setField(row, column, readScalar());
+                }
+            } while (accept(','));
+            expect('}');
+        }
+        skipSpace();
+        if (pos != text.size()) {
+            throw error("unexpected text after the object");
+        }
+        return row;
+    }
+
+private:
+    runtime_error error(const string& what) const
+    {
+        return lineError(line, what + " at character " + to_string(pos + 1));
+    }
+
+    void skipSpace()
+    {
+        while (pos < text.size() && isspace(static_cast<unsigned char>(text[pos]))) {
+            pos++;
+        }
+    }
+
+    char peek() const { return pos < text.size() ? text[pos] : '\0'; }
+
+    bool accept(char c)
+    {
+        skipSpace();
+        if (peek() != c) {
+            return false;
+        }
+        pos++;
+        return true;
+    }
+
+    void expect(char c)
+    {
+        if (!accept(c)) {
+            throw error(string("expected '") + c + "'");
+        }
+    }
+
+    string readString()
+    {
+        expect('"');
+        string value;
+        while (peek() != '"') {
+            char c = peek();
+            if (c == '\0') {
+                throw error("unterminated string");
+            }
+            pos++;
+            if (c != '\\') {
+                value += c;
+                continue;
+            }
+            char escaped = peek();
+            pos++;
+            switch (escaped) {
+            case '"': case '\\': case '/': value += escaped; break;
+            case 'b': value += '\b'; break;
+            case 'f': value += '\f'; break;
+            case 'n': value += '\n'; break;
+            case 'r': value += '\r'; break;
+            case 't': value += '\t'; break;
+            case 'u': value += readCodePoint(); break;
+            default: throw error("invalid escape");
+            }
+        }
+        pos++;
+        return value;
+    }
+
+    //The four hex digits after \u, as UTF-8 (surrogate pairs are not needed for names and codes)
+    string readCodePoint()
+    {
+        if (pos + 4 > text.size()) {
+            throw error("invalid \\u escape");
+        }
+        unsigned code = 0;
+        for (int i = 0; i < 4; i++) {
+            char c = text[pos++];
+            if (!isxdigit(static_cast<unsigned char>(c))) {
+                throw error("invalid \\u escape");
+            }
+            code = code * 16 + static_cast<unsigned>(isdigit(static_cast<unsigned char>(c)) ? c - '0' : (tolower(c) - 'a' + 10));
+        }
+        string utf8;
+        if (code < 0x80) {
+            utf8 += static_cast<char>(code);
+        } else if (code < 0x800) {
+            utf8 += static_cast<char>(0xC0 | (code >> 6));
+            utf8 += static_cast<char>(0x80 | (code & 0x3F));
+        } else {
+            utf8 += static_cast<char>(0xE0 | (code >> 12));
+            utf8 += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            utf8 += static_cast<char>(0x80 | (code & 0x3F));
+        }
+        return utf8;
+    }
+
+    //A string, or the text of a number (checked later, as a command line value would be). null is empty
+    string readScalar()
+    {
+        skipSpace();
+        if (peek() == '"') {
+            return readString();
+        }
+        size_t start = pos;
+        while (pos < text.size() && (isalnum(static_cast<unsigned char>(text[pos])) || text[pos] == '-'
+                                     || text[pos] == '+' || text[pos] == '.')) {
+            pos++;
+        }
+        if (pos == start) {
+            throw error("expected a value");
+        }
+        string value(text.substr(start, pos - start));
+        return value == "null" ? string() : value;
+    }
+
+    vector<string> readArray()
+    {
+        vector<string> items;
+        expect('[');
+        if (accept(']')) {
+            return items;
+        }
+        do {
+            items.push_back(readScalar());
+        } while (accept(','));
+        expect(']');
+        return items;
+    }
+
+    string_view text;
+    size_t line;
+    size_t pos = 0;
+};
+
+vector<ImportRow> readImportRows(istream& ip, ImportFormat format)
+{
+    vector<ImportRow> rows;
+    vector<Column> columns = {SID, NAME, PHONE, MODULECODES, GRADES};
+    bool header = false;
+    string text;
+    size_t line = 0;
+    while (getline(ip, text)) {
+        line++;
+        if (!text.empty() && text.back() == '\r') {
+            text.pop_back();
+        }
+        if (text.find_first_not_of(" \t") == string::npos) {
+            continue;
+        }
+
+        if (format == ImportFormat::JSONL) {
+            rows.push_back(JsonLine(text, line).read());
+            continue;
+        }
+
+        vector<string> fields = csvFields(text, line);
+        if (rows.empty() && !header) {
+            //A header says which column is which (a student ID can never be "sid")
+            vector<Column> named;
+            for (const string& f : fields) {
+                vector<string> name = words(f);
+                named.push_back(name.size() == 1 ? columnNamed(name[0]) : OTHER);
+            }
+            if (find(named.begin(), named.end(), SID) != named.end()) {
+                columns = named;
+                header = true;
+                continue;
+            }
+        }
+        ImportRow row;
+        row.line = line;
+        for (size_t i = 0; i < fields.size() && i < columns.size(); i++) {
+            setField(row, columns[i], move(fields[i]));
+        }
+        rows.push_back(move(row));
+    }
+    return rows;
+}
+
+string checkImportRow(const ImportRow& row, ImportedStudent& student)
+{
+    NumberResult result = parseInt(row.sid, student.sid);
+    if (!result.ok()) {
+        return numberErrorMessage(result, row.sid, "student ID");
+    }
+    if (student.sid < 0) {
+        return "Student ID must be a positive integer";
+    }
+    if (!isStorableName(row.name)) {
+        return row.name.empty() ? string("Missing name")
+                                : "Invalid name \"" + row.name + "\" (a name cannot hold line breaks or control characters)";
+    }
+    if (!row.phone.empty() && !isValidPhoneNumber(row.phone)) {
+        return "Invalid phone number \"" + row.phone + "\" (digits and dashes only)";
+    }
+    for (const string& code : row.moduleCodes) {
+        if (!isValidModuleCode(code)) {
+            return "Invalid module code \"" + code + "\". Module codes must be alphanumeric";
+        }
+    }
+    if (!row.grades.empty() && row.grades.size() != row.moduleCodes.size()) {
+        return "Number of module codes and grades do not match";
+    }
+    student.grades.clear();
+    for (const string& grade : row.grades) {
+        float value = 0;
+        result = parseFloat(grade, value);
+        if (!result.ok()) {
+            return numberErrorMessage(result, grade, "grade");
+        }
+        student.grades.push_back(value);
+    }
+    return string();
+}
@@ -0,0 +1,59 @@
+#ifndef IMPORT_H
+#define IMPORT_H
+#include <cstddef>
+#include <istream>
+#include <string>
+#include <vector>
+
+/*
+ * Reading and checking many new students at once (addrecord -import)
+ *
+ * CSV has one student per line, in the columns sid, name, phone, modulecodes, grades. A first
+ * line that names the columns (including sid) is a header, and then the columns may be in any
+ * order, or left out (unknown ones are ignored). Fields may be quoted ("Jo King"), and the module
+ * codes and grades are lists separated by spaces, as on the command line:
+ *
+ *  sid,name,phone,modulecodes,grades
+ *  24680,Jo King,44-1234-456123,COMP101 COMP110,40.5 55.6
+ *
+ * JSON Lines has one object per line, with the same names:
+ *
+ *  {"sid": 24680, "name": "Jo King", "modulecodes": ["COMP101", "COMP110"], "grades": [40.5, 55.6]}
+ *
+ * Blank lines are skipped in both.
+ */
+
+//Layout of an import file
+enum class ImportFormat {
+    CSV,
+    JSONL
+};
+
+//One student as read from an import file, before it has been checked
+struct ImportRow {
+    size_t line = 0;    //Line of the import file, from 1
+    std::string sid;
+    std::string name;
+    std::string phone;
+    std::vector<std::string> moduleCodes;
+    std::vector<std::string> grades;
+};
+
+//A checked student, ready to be added
+struct ImportedStudent {
+    int sid = 0;
+    std::vector<float> grades;
+};
+
+//Functions
+
+//Read every student in `ip`
+//Throws std::runtime_error, naming the line, if the file is not valid CSV or JSON
+std::vector<ImportRow> readImportRows(std::istream& ip, ImportFormat format);
+
+//Check `row` against the rules for a new record (as for the -sid, -name, -phone, -modulecodes and
+//-grades options), converting its numbers into `student`
+//Returns what is wrong with it, or an empty string if nothing is. Safe to call from several threads
+std::string checkImportRow(const ImportRow& row, ImportedStudent& student);
+
+#endif // IMPORT_H
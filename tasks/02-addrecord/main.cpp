@@ -22,12 +22,13 @@
  *
  * Where -sid is provided, the following MUST also be included:
  *    • The tag -name and a student name <name>.
- *       o <name> is a full name, so will comprise only alphabetical characters and spaces.
- *       o <name> must contain at least two words separated by spaces.
+ *       o <name> is the student's full name, stored as it is given. It must not be empty or hold a line
+ *         break or other control character, but its words are not checked, so names such as Cher, Siobhan O'Brien or Jo Smith-King are
+ *         accepted. -import checks names in exactly the same way.
  *
  * Where -sid is provided, the following MAY also be included:
  *    • The tag -phone followed by a phone number.
- *      o <phone-number> is a string with no spaces.
+ *      o <phone-number> is made of digits and dashes only.
  *    • The tag -modulecodes, followed by a list of module codes.
  *       o Each module code is a single alpha-numeric word. It cannot contain any symbols.
  *       o Each module code is separated by a space.
@@ -39,6 +40,22 @@
  *       o The number of grades MUST match the number of module codes.
  *       o You cannot use -grades tag without an accompanying -modulecodes tag
  *
+ * Many students can be added at once with
+ *  addrecord -db <database file> -import <file> [-format csv|jsonl] [-threads <n>]
+ *    o <file> is a CSV or JSON Lines file of students (see import.h), or - to read standard input.
+ *    o The format is taken from the file name (.jsonl or .json for JSON Lines, anything else is CSV)
+ *      unless -format is given. Standard input is CSV unless -format says otherwise.
+ *    o Every student is checked with the rules above, on <n> threads (0 = one per processor, default 1),
+ *      and against the student IDs already in the database and earlier in the file.
+ *    o If any student fails a check, every problem is listed and nothing is added.
+ *      Otherwise all of them are appended in one buffered write.
+ *
+ * Any number of addrecord processes may add to the same database at once. A record added with -sid goes
+ *  through the journal (see journal.h): records arriving together are checked for duplicate student IDs
+ *  and appended in one write and one sync, and none is lost or added twice. An import holds the database lock throughout.
+ *
+ * -stats may be added anywhere to write timings and resource use to stderr as key=value pairs: the time
+ *  spent in each phase (open, parse, write), the parse rate, the peak resident memory and the number of heap allocations
  *
  * **********************
  * *** VALID EXAMPLES ***
@@ -50,7 +67,7 @@
  * Add a record with a student ID <id> and name <name>, where <id> is an integer and name <name> is a string (space separated)
  *  addrecord -db computing.txt -sid 12345 -name Sam Eold
  *
- * This version also includes the phone number <phone>, where <phone> is a string with no spaces
+ * This version also includes the phone number <phone>, where <phone> is digits and dashes
  *  addrecord -db computing.txt -sid 12345 -name Sam Eold -phone 44-1234-456123
  *
  * This version includes the modules the student is enrolled on
@@ -59,6 +76,9 @@
  * This includes the grades as well as the module codes. The number of grades must equal the number of codes or an error is displayed
  *  addrecord -db computing.txt -sid 24680 -name Jo King -modulecodes COMP101 COMP110 COMP123 COMP145 COMP165 -grades 40.5 55.6 35.7 67.5 80.1
  *
+ * Add every student listed in newstudents.csv
+ *  addrecord -db computing.txt -import newstudents.csv
+ *
  *
  * *************************************
  * *** EXAMPLES OF INVALID ARGUMENTS ***
@@ -109,30 +129,91 @@
 #include <fstream>
 #include <vector>
 #include <sstream>
-#include <regex>
 #include <map>
 #include <string>
 #include "testdb.h"
 #include "studentrecord.h"
+#include "numparse.h"
+#include "recordwriter.h"
+#include "runstats.h"
+#include "validate.h"
+#include "snapshot.h"
+#include "sidindex.h"
+#include "import.h"
+#include "dblock.h"
+#include "journal.h"
+#include <algorithm>
+#include <thread>
+#include <unordered_set>
 using namespace std;
+
+// See below main
+int findArg(int argc, char* argv[], string pattern);
+int importRecords(const string& filename, const string& source, ImportFormat format, unsigned threads);
+
 int main(int argc, char* argv[]) {
     if (argc == 1) {
         // Welcome message
         cout << "addrecord (c)2023" << endl;
 
         // Create some test data
-        ofstream testFile("computing.txt");
-        if (testFile.is_open()) {
-            testFile << "Sample data for testing\n";
-            testFile.close();
+        createTestDB("computing.txt");
+
+        // Done
+        return EXIT_SUCCESS;
+    }
+
+    // -stats may be given anywhere, so it is picked out before anything else happens
+    for (int i = 1; i < argc; ++i) {
+        if (string(argv[i]) == "-stats") {
+            runStats().enable("addrecord", "open");
         }
-        else {
-            cerr << "Error: Unable to create test database file\n";
+    }
+
+    // Bulk import
+    int p = findArg(argc, argv, "-import");
+    if (p) {
+        int db = findArg(argc, argv, "-db");
+        if (!db || db == argc - 1 || argv[db + 1][0] == '-') {
+            cerr << "Error: Missing database filename\n";
             return EXIT_FAILURE;
         }
+        if (p == argc - 1) {
+            cerr << "Error: Missing import file name\n";
+            return EXIT_FAILURE;
+        }
+        string source = argv[p + 1];
 
-        // Done
-        return EXIT_SUCCESS;
+        ImportFormat format = ImportFormat::CSV;
+        string extension = source.substr(min(source.rfind('.'), source.size()));
+        if (extension == ".jsonl" || extension == ".json") {
+            format = ImportFormat::JSONL;
+        }
+        int f = findArg(argc, argv, "-format");
+        if (f) {
+            string name = f < argc - 1 ? argv[f + 1] : "";
+            if (name == "csv") {
+                format = ImportFormat::CSV;
+            }
+            else if (name == "jsonl") {
+                format = ImportFormat::JSONL;
+            }
+            else {
+                cerr << "Error: -format must be csv or jsonl\n";
+                return EXIT_FAILURE;
+            }
+        }
+
+        int threads = 1;
+        int t = findArg(argc, argv, "-threads");
+        if (t) {
+            NumberResult result = t < argc - 1 ? parseInt(argv[t + 1], threads) : NumberResult{NumberError::EMPTY, 0};
+            if (!result.ok() || threads < 0) {
+                cerr << "Error: Please provide a number of threads after -threads\n";
+                return EXIT_FAILURE;
+            }
+        }
+        return importRecords(argv[db + 1], source, format, static_cast<unsigned>(threads));
     }
 
     if (argc < 6) {
@@ -141,9 +222,10 @@ int main(int argc, char* argv[]) {
     }
 
     // Extract command line arguments
-    string filename, sid, name, phone;
+    string filename, name, phone;
     int Sid;
-    vector<string> moduleCodes, grades;
+    vector<string> moduleCodes;
+    vector<float> grades;
 
     bool hasModuleCodes = false;
     bool hasGrades = false;
@@ -173,19 +255,16 @@ int main(int argc, char* argv[]) {
         else if (arg == "-sid") {
             if (i + 1 < argc) {
                 // Validate that SID is a valid unsigned integer
-                try {
-                    Sid = stoi(argv[i + 1]);
-                    if (Sid < 0) {
-                        cerr << "Error: Student ID must be a positive integer\n";
-                        return EXIT_FAILURE;
-                    }
-                    hasSID = true; // Flag that SID is provided
+                NumberResult result = parseInt(argv[i + 1], Sid);
+                if (!result.ok()) {
+                    cerr << "Error: " << numberErrorMessage(result, argv[i + 1], "student ID") << ". Please provide a positive integer.\n";
+                    return EXIT_FAILURE;
                 }
-                catch (const invalid_argument& e) {
-                    cerr << "Error: Invalid student ID. Please provide a positive integer.\n";
+                if (Sid < 0) {
+                    cerr << "Error: Student ID must be a positive integer\n";
                     return EXIT_FAILURE;
                 }
-                sid = to_string(Sid);
+                hasSID = true; // Flag that SID is provided
                 ++i; // Move to the next argument
             }
             else {
@@ -224,14 +303,13 @@ int main(int argc, char* argv[]) {
             hasGrades = true;
             while (i + 1 < argc && argv[i + 1][0] != '-') {
                 // Validate that grades are valid fractional numbers
-                try {
-                    stof(argv[i + 1]);
-                }
-                catch (const invalid_argument& e) {
-                    cerr << "Error: Invalid grade. Please provide a valid fractional number.\n";
+                float grade;
+                NumberResult result = parseFloat(argv[i + 1], grade);
+                if (!result.ok()) {
+                    cerr << "Error: " << numberErrorMessage(result, argv[i + 1], "grade") << ". Please provide a valid fractional number.\n";
                     return EXIT_FAILURE;
                 }
-                grades.push_back(argv[i + 1]);
+                grades.push_back(grade);
                 ++i; // Move to the next argument
             }
         }
@@ -239,7 +317,7 @@ int main(int argc, char* argv[]) {
             hasModuleCodes = true;
             while (i + 1 < argc && argv[i + 1][0] != '-') {
                 // Validate that module codes are alphanumeric
-                if (!regex_match(argv[i + 1], regex("^[a-zA-Z0-9]+$"))) {
+                if (!isValidModuleCode(argv[i + 1])) {
                     cerr << "Error: Invalid module code. Module codes must be alphanumeric.\n";
                     return EXIT_FAILURE;
                 }
@@ -261,6 +339,16 @@ int main(int argc, char* argv[]) {
         return EXIT_FAILURE;
     }
 
+    if (!isStorableName(name)) {
+        cerr << "Error: Invalid student name. A name cannot be empty or hold line breaks or control characters\n";
+        return EXIT_FAILURE;
+    }
+
+    if (!phone.empty() && !isValidPhoneNumber(phone)) {
+        cerr << "Error: Invalid phone number. A phone number is made of digits and dashes only\n";
+        return EXIT_FAILURE;
+    }
+
     if (moduleCodes.size() == grades.size()) {
         cerr << "good\n";
     }
@@ -269,72 +357,201 @@ int main(int argc, char* argv[]) {
         return EXIT_FAILURE;
     }
 
-    if (!hasModuleCodes) {
+    if (hasGrades && !hasModuleCodes) {
         cerr << "Error: Grades cannot be given unless modules are not there!\n";
         
     }
 
-    // Check for duplicate student IDs
-    ifstream inFile(filename);
-    if (inFile.is_open()) {
-        string line;
-        while (getline(inFile, line)) {
-            if (line.find("#SID") != string::npos) {
-                getline(inFile, line); // Read the SID value
-                if (line.find(sid) != string::npos) {
-                    cerr << "Error: Student ID already exists\n";
-                    inFile.close();
-                    return EXIT_FAILURE;
-                }
+    // The database must already exist (the journal creates nothing but its own spool)
+    SourceStamp before;
+    if (!sourceStamp(filename, before)) {
+        cerr << "Error: Unable to open database file for reading\n";
+        return EXIT_FAILURE;
+    }
+
+    // Build the record in memory through the shared writer, so it is handed over as one block
+    runStats().phase("write");
+    Record added;
+    added.SID = Sid;
+    added.name = name;
+    added.phone = phone;
+    for (const auto& code : moduleCodes) {
+        added.enrollments.push_back(moduleId(code));
+    }
+    added.grades = grades;
+    stringstream record;
+    {
+        RecordWriter out(record);
+        out.writeDatabaseRecord(viewOf(added));
+    }
+
+    // Append it through the journal, which checks for a duplicate student ID under the database lock
+    // and commits it together with any other records being added at the same time (see journal.h)
+    switch (journaledAppend(filename, record.str())) {
+    case AppendOutcome::ADDED:
+        cout << "Data Added Successfully!\n";
+        break;
+    case AppendOutcome::DUPLICATE:
+        cerr << "Error: Student ID already exists\n";
+        return EXIT_FAILURE;
+    case AppendOutcome::INVALID:
+        cerr << "Error: Record could not be written in the database layout\n";
+        return EXIT_FAILURE;
+    case AppendOutcome::FAILED:
+        cerr << "Error: Unable to write to database file\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+// Function to add every student in the import file `source` (- for standard input) to the database `filename`
+// Either all of them are added, or (if any is invalid) none
+int importRecords(const string& filename, const string& source, ImportFormat format, unsigned threads)
+{
+    // Read the students
+    runStats().phase("read");
+    vector<ImportRow> rows;
+    try {
+        if (source == "-") {
+            rows = readImportRows(cin, format);
+        }
+        else {
+            ifstream ip(source);
+            if (!ip.is_open()) {
+                cerr << "Error: Unable to open import file " << source << "\n";
+                return EXIT_FAILURE;
             }
+            rows = readImportRows(ip, format);
+            ip.close();
         }
-        inFile.close();
     }
-    else {
-        cerr << "Error: Unable to open database file for reading\n";
+    catch (const exception& e) {
+        cerr << "Error: Unable to read import file - " << e.what() << "\n";
         return EXIT_FAILURE;
     }
 
-    // Add record to the file
-    ofstream outFile(filename, ios::app);
-    if (!outFile.is_open()) {
-        cerr << "Error: Unable to open database file for writing\n";
+    // Check each student on its own, sharing the rows out between the threads
+    runStats().phase("check");
+    vector<ImportedStudent> students(rows.size());
+    vector<string> problems(rows.size());
+    if (threads == 0) {
+        threads = max(1u, thread::hardware_concurrency());
+    }
+    threads = static_cast<unsigned>(min<size_t>(threads, max<size_t>(1, rows.size())));
+    auto checkRows = [&](size_t from, size_t to) {
+        for (size_t i = from; i < to; i++) {
+            problems[i] = checkImportRow(rows[i], students[i]);
+        }
+    };
+    vector<thread> workers;
+    size_t share = (rows.size() + threads - 1) / threads;
+    for (unsigned t = 1; t < threads; t++) {
+        workers.emplace_back(checkRows, min(rows.size(), t * share), min(rows.size(), (t + 1) * share));
+    }
+    checkRows(0, min(rows.size(), share));
+    for (thread& worker : workers) {
+        worker.join();
+    }
+
+    // Nothing else may change the database between the check and the append
+    DatabaseLock lock;
+    if (!lock.lock(filename) || !recoverJournal(filename)) {
+        cerr << "Error: Unable to lock database file\n";
         return EXIT_FAILURE;
     }
 
-    // Write the record to the file in the desired format
-    outFile << "#RECORD\n";
-    outFile << " #SID\n";
-    outFile << "     " << sid << "\n";
-    outFile << " #NAME\n";
-    outFile << "     " << name << "\n";
-    if (!moduleCodes.empty()) {
-        outFile << " #ENROLLMENTS\n";
-        outFile << "     ";
-        for (const auto& code : moduleCodes) {
-            outFile << code << " ";
+    // The student IDs already in use, collected in one pass over the database
+    runStats().phase("parse");
+    unordered_set<int> used;
+    {
+        RecordStore db;
+        try {
+            ifstream exists(filename);
+            if (exists.is_open()) {
+                exists.close();
+                if (!loadDatabase(filename, db)) {
+                    cerr << "Error: Unable to open database file for reading\n";
+                    return EXIT_FAILURE;
+                }
+            }
+        }
+        catch (const exception& e) {
+            cerr << "Error: Unable to read database file - " << e.what() << "\n";
+            return EXIT_FAILURE;
+        }
+        SourceStamp loaded;
+        if (runStats().enabled() && sourceStamp(filename, loaded)) {
+            runStats().parsed(loaded.size, db.size());
         }
-        outFile << "\n";
+        used.reserve(db.size() + rows.size());
+        used.insert(db.sidColumn().begin(), db.sidColumn().end());
     }
 
-    if (!grades.empty()) {
-        outFile << " #GRADES\n";
-        outFile << "     ";
-        for (const auto& grade : grades) {
-            outFile << grade << " ";
+    // Every problem is reported, so the file can be fixed in one go
+    runStats().phase("check");
+    size_t invalid = 0;
+    for (size_t i = 0; i < rows.size(); i++) {
+        if (problems[i].empty() && !used.insert(students[i].sid).second) {
+            problems[i] = "Student ID " + to_string(students[i].sid) + " already exists";
+        }
+        if (!problems[i].empty()) {
+            cerr << "Error: Line " << rows[i].line << ": " << problems[i] << "\n";
+            invalid++;
         }
-        outFile << "\n";
     }
-    
-    
-    if (!phone.empty()) {
-        outFile << " #PHONE\n";
-        outFile << "     " << phone << "\n";
+    if (invalid > 0) {
+        cerr << "Error: " << invalid << " of " << rows.size() << " students are invalid - none were added\n";
+        return EXIT_FAILURE;
+    }
+
+    // Append them all through one buffered writer
+    runStats().phase("write");
+    ofstream outFile(filename, ios::app | ios::binary);
+    if (!outFile.is_open()) {
+        cerr << "Error: Unable to open database file for writing\n";
+        return EXIT_FAILURE;
+    }
+    {
+        RecordWriter out(outFile);
+        Record added;
+        for (size_t i = 0; i < rows.size(); i++) {
+            added.SID = students[i].sid;
+            added.name = rows[i].name;
+            added.phone = rows[i].phone;
+            added.enrollments.clear();
+            for (const string& code : rows[i].moduleCodes) {
+                added.enrollments.push_back(moduleId(code));
+            }
+            added.grades = students[i].grades;
+            out.writeDatabaseRecord(viewOf(added));
+        }
     }
-    
-    cout << "Data Added Successfully!\n";
-    // Close the file
     outFile.close();
+    if (!outFile) {
+        cerr << "Error: Unable to write to database file\n";
+        return EXIT_FAILURE;
+    }
 
+    // Every new record would need its own entry, so the SID index is rebuilt in one pass instead
+    if (indexExists(filename)) {
+        buildIndex(filename);
+    }
+
+    cout << rows.size() << " students added successfully!\n";
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
+
+// Function to find an argument on the command line and return the location
+int findArg(int argc, char* argv[], string pattern)
+{
+    for (int n = 1; n < argc; n++)
+    {
+        string s1(argv[n]);
+        if (s1 == pattern)
+        {
+            return n;
+        }
+    }
+    return 0;
+}
@@ -2,11 +2,24 @@
 #include <fstream>
 #include <vector>
 #include <sstream>
-#include <regex>
-#include <map>
+#include <algorithm>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include "testdb.h"
 #include "studentrecord.h"
+#include "numparse.h"
+#include "recordstore.h"
+#include "recordwriter.h"
+#include "runstats.h"
+#include "validate.h"
+#include "snapshot.h"
+#include "sidindex.h"
+#include "dblock.h"
+#include "journal.h"
+#include "recordpatch.h"
+#include "delta.h"
+#include "rewrite.h"
 using namespace std;
 
 /*
@@ -33,6 +46,34 @@ using namespace std;
  * 
  *   o An individual student grade can be added OR updated using the -modulecode and -grade parameters together.
  *
+ * Only the record being changed is read and written. It is found through the SID index if there is one
+ *  (querydb -buildindex), otherwise by scanning the student IDs, and written back over its old place in the
+ *  file, or moved to the end of the file if it has outgrown that place (see recordpatch.h)
+ *
+ * With -delta, the change is appended to the delta log <database file>.delta instead (see delta.h), so the
+ *  database file is not written. The record is still found as above and brought up to date from the log, so
+ *  an update costs an index lookup and a read of the log with the SID index (querydb -buildindex), but a
+ *  scan of the student IDs without it. Every tool applies the log as it loads the database.
+ *  Once a delta log exists, every update goes to it until it is compacted:
+ *
+ *  updaterecord -db <database file> -compact [-force]
+ *   Folds the delta log back into a clean database file, if it has grown past the limits in delta.h
+ *   (or whatever its size, with -force). Meant to be run from time to time, e.g. by a scheduled job.
+ *
+ * Many updates can be made at once with
+ *  updaterecord -db <database file> -batch <script> [-delta]
+ *   <script> is a file of updates (or - to read standard input), one per line, with the same values as the options:
+ *     12345 name Jo  Kingly
+ *     12345 phone 00-12-34567
+ *     12345 modulecode COMP1001 78.4      (the grade may be left out, to enrol only)
+ *   Blank lines and lines starting with # are ignored. The database is loaded once, every update is checked
+ *   and applied in order, and the database (or the delta log) is written once: a new copy of the file is made
+ *   with only the changed records written afresh (see rewrite.h), and swapped in when it is complete.
+ *   An update that fails its checks is reported with its line number and skipped, and the rest are still applied.
+ *
+ * -stats may be added to write timings and resource use to stderr as key=value pairs: the time spent in each
+ *  phase (open, locate, update, write, compact, and read and parse for -batch), the parse rate, the peak resident memory and the number of heap allocations
+ *
  * Note that the format of all data items should be consistent with those specified in the previous tasks.
  * The same error checking should also apply.
  *
@@ -101,109 +142,25 @@ using namespace std;
 // Main program here
 
 
-class StudentRecord {
-private:
-    string studentID;
-    string name;
-    string phoneNumber;
-    map<string, string> moduleGrades;
-
-public:
-    StudentRecord(const string& id, const string& studentName) : studentID(id), name(studentName) {}
-
-    string getStudentID() const {
-        return studentID;
-    }
-    string getName() const {
-        return name;
-    }
-    string getPhoneNumber() const {
-        return phoneNumber;
-    }
-
-    void setName(const string& studentName) {
-        name = studentName;
-    }
-
-    void setPhoneNumber(const string& phone) {
-        phoneNumber = phone;
-    }
-
-    void addModuleGrade(const string& moduleCode, const string& grade) {
-        moduleGrades[moduleCode] = grade;
-    }
-};
-
-vector<StudentRecord> readStudentRecords(const string& dbFile) {
-    vector<StudentRecord> records;
-    ifstream inFile(dbFile);
-    if (!inFile.is_open()) {
-        cerr << "Error: Unable to open database file for reading\n";
-        return records;
-    }
-
-    string line;
-    while (getline(inFile, line)) {
-        if (line.find("#RECORD") != string::npos) {
-            string sid, name, phone, moduleCode, grade;
-            while (getline(inFile, line) && !line.empty()) {
-                if (line.find("#SID") != string::npos) {
-                    sid = line.substr(line.find_first_of("0123456789"));
-                }
-                else if (line.find("#NAME") != string::npos) {
-                    name = line.substr(line.find_first_of("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ"));
-                }
-                else if (line.find("#PHONE") != string::npos) {
-                    phone = line.substr(line.find_first_of("0123456789"));
-                }
-                else if (line.find("#ENROLLMENTS") != string::npos) {
-                    // Process enrollments
-                }
-                else if (line.find("#GRADES") != string::npos) {
-                    // Process grades
-                }
-            }
-            records.emplace_back(sid, name);
-            records.back().setPhoneNumber(phone);
-        }
-    }
-
-    inFile.close();
-    return records;
-}
-
-bool isUnsignedInteger(const string& str) {
-    return !str.empty() && str.find_first_not_of("0123456789") == string::npos;
-}
-
-bool isValidName(const string& name) {
-    bool isValid = !name.empty() && regex_match(name, regex("^[a-zA-Z]+ ([\\s][a-zA-Z]+)+$"));
+// The checks themselves are in validate.h. isValidName alone would let a line break through (as one of
+// its whitespace characters), so the name must also be storable
+bool checkName(const string& name) {
+    bool isValid = isValidName(name) && isStorableName(name);
     if (!isValid) {
         cerr << "Error: Invalid name format - " << name << endl;
     }
     return isValid;
 }
-bool isValidPhoneNumber(const string& phone) {
-    return !phone.empty() && regex_match(phone, regex("^[0-9-]+$"));
-}
-
-bool isValidModuleCode(const string& code) {
-    return !code.empty() && regex_match(code, regex("^[a-zA-Z0-9]+$"));
-}
-
-bool isValidGrade(const string& grade) {
-    return !grade.empty() && regex_match(grade, regex("^[0-9]+(\\.[0-9]+)?$"));
-}
 
-int updateRecord(const string& dbFile, const string& sid, const string& name, const string& phone, const string& moduleCode, const string& grade) {
+int updateRecord(const string& dbFile, const string& sid, const string& name, const string& phone, const string& moduleCode, const string& grade, bool useDeltas) {
     // Validate the provided student ID
-    if (!isUnsignedInteger(sid)) {
+    if (!isValidStudentId(sid)) {
         cerr << "Error: Student ID must be a positive integer\n";
         return EXIT_FAILURE;
     }
 
     // Validate the provided name
-    if (!isValidName(name)) {
+    if (!checkName(name)) {
         cerr << "Error: Invalid student name\n";
         return EXIT_FAILURE;
     }
@@ -214,10 +171,14 @@ int updateRecord(const string& dbFile, const string& sid, const string& name, co
         return EXIT_FAILURE;
     }
 
-    // Validate the provided module code and grade
-    if (!moduleCode.empty() && !grade.empty()) {
-        if (!isValidModuleCode(moduleCode)) {
-            cerr << "Error: Invalid module code format\n";
+    // Validate the provided module code and grade (a grade is always for a module)
+    if (!moduleCode.empty() && !isValidModuleCode(moduleCode)) {
+        cerr << "Error: Invalid module code format\n";
+        return EXIT_FAILURE;
+    }
+    if (!grade.empty()) {
+        if (moduleCode.empty()) {
+            cerr << "Error: Missing module code for the grade\n";
             return EXIT_FAILURE;
         }
         if (!isValidGrade(grade)) {
@@ -226,47 +187,286 @@ int updateRecord(const string& dbFile, const string& sid, const string& name, co
         }
     }
 
-    // Read the existing student records from the database file
-    vector<StudentRecord> records = readStudentRecords(dbFile);
+    // Hold the database lock from reading to writing, so no other change is made to the record meanwhile
+    DatabaseLock lock;
+    if (!lock.lock(dbFile) || !recoverJournal(dbFile)) {
+        cerr << "Error: Unable to lock database file\n";
+        return EXIT_FAILURE;
+    }
 
-    // Locate the record with the provided student ID
-    auto it = find_if(records.begin(), records.end(), [&](const StudentRecord& record) {
-        return record.getStudentID() == sid;
-        });
+    // Find the record with the provided student ID (through the SID index when there is one)
+    runStats().phase("locate");
+    int id = 0;
+    RecordSpan slot;
+    size_t scanned = 0;
+    Record r;
+    try {
+        ifstream exists(dbFile);
+        if (!exists.is_open()) {
+            cerr << "Error: Unable to open database file for reading\n";
+            return EXIT_FAILURE;
+        }
+        exists.close();
+        if (!parseInt(sid, id).ok() || !locateRecord(dbFile, id, slot, &scanned)) {
+            cerr << "Error: Student record with ID " << sid << " not found\n";
+            return EXIT_FAILURE;
+        }
+        if (!readRecordAt(dbFile, slot, r) || r.SID != id) {
+            cerr << "Error: Unable to read the record of student " << sid << "\n";
+            return EXIT_FAILURE;
+        }
+    }
+    catch (const exception& e) {
+        cerr << "Error: Unable to read database file - " << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+    //The student IDs scanned to find the record (none through the index), then the record itself
+    runStats().parsed(scanned + slot.length, 1);
+
+    // The record as it stands, with any changes still waiting in the delta log
+    try {
+        mergeDeltas(dbFile, r);
+    }
+    catch (const exception& e) {
+        cerr << "Error: Unable to read delta log - " << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
 
-    if (it != records.end()) {
-        // Update the student record with the provided information
-        it->setName(name);
-        it->setPhoneNumber(phone);
-        it->addModuleGrade(moduleCode, grade);
+    // Update the student record with the provided information
+    runStats().phase("update");
+    vector<Delta> changes;
+    Delta change;
+    change.sid = id;
+    change.field = DeltaField::NAME;
+    change.text = name;
+    changes.push_back(change);
+    if (!phone.empty()) {
+        change.field = DeltaField::PHONE;
+        change.text = phone;
+        changes.push_back(change);
+    }
+    if (!moduleCode.empty()) {
+        change.field = grade.empty() ? DeltaField::ENROL : DeltaField::GRADE;
+        change.module = moduleId(moduleCode);
+        if (!grade.empty()) {
+            parseFloat(grade, change.grade);
+        }
+        changes.push_back(change);
+    }
+    for (const Delta& d : changes) {
+        if (!applyDelta(r, d)) {
+            cerr << "Error: Cannot add a grade for " << moduleCode << " before the grades of the modules enrolled on ahead of it\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Once there is a delta log, changes go on the end of it (in order) until it is compacted
+    runStats().phase("write");
+    if (useDeltas || hasDeltas(dbFile)) {
+        if (!appendDeltas(dbFile, changes)) {
+            cerr << "Error: Unable to write to delta log\n";
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    // Otherwise write the record back over its old place in the file, or move it to the end if it no longer fits
+    if (patchRecord(dbFile, slot, viewOf(r)) == PatchOutcome::FAILED) {
+        cerr << "Error: Unable to write to database file\n";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+// Function to fold the delta log into the database, if it has grown past the limits in delta.h (or always, if `force` is set)
+int compactDeltas(const string& dbFile, bool force) {
+    DatabaseLock lock;
+    if (!lock.lock(dbFile) || !recoverJournal(dbFile)) {
+        cerr << "Error: Unable to lock database file\n";
+        return EXIT_FAILURE;
+    }
+    if (!hasDeltas(dbFile) || !(force || compactionDue(dbFile))) {
+        cout << "Nothing to compact\n";
+        return EXIT_SUCCESS;
+    }
+    runStats().phase("compact");
+    try {
+        size_t folded = compactDatabase(dbFile);
+        cout << folded << " changes compacted into " << dbFile << "\n";
+    }
+    catch (const exception& e) {
+        cerr << "Error: Unable to compact database file - " << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+// Function to check one line of an update script and turn it into a change for `change.sid`
+// Returns what is wrong with it, or an empty string if nothing is
+string parseUpdate(const string& line, Delta& change) {
+    istringstream words(line);
+    string sid, field, rest;
+    words >> sid >> field;
+    getline(words, rest);
+    rest.erase(0, rest.find_first_not_of(' '));
+    rest.erase(rest.find_last_not_of(" \r") + 1);
+
+    if (!isValidStudentId(sid) || !parseInt(sid, change.sid).ok()) {
+        return "Student ID must be a positive integer";
+    }
+    if (field == "name") {
+        if (!isValidName(rest) || !isStorableName(rest)) {
+            return "Invalid name format - " + rest;
+        }
+        change.field = DeltaField::NAME;
+        change.text = rest;
+    }
+    else if (field == "phone") {
+        if (!isValidPhoneNumber(rest)) {
+            return "Invalid phone number format - " + rest;
+        }
+        change.field = DeltaField::PHONE;
+        change.text = rest;
+    }
+    else if (field == "modulecode") {
+        istringstream values(rest);
+        string code, grade, extra;
+        values >> code >> grade >> extra;
+        if (!isValidModuleCode(code)) {
+            return "Invalid module code format - " + code;
+        }
+        if (!extra.empty()) {
+            return "Too many values after modulecode";
+        }
+        change.field = DeltaField::ENROL;
+        change.module = moduleId(code);
+        if (!grade.empty()) {
+            if (!isValidGrade(grade)) {
+                return "Invalid grade format - " + grade;
+            }
+            change.field = DeltaField::GRADE;
+            parseFloat(grade, change.grade);
+        }
     }
     else {
-        cerr << "Error: Student record with ID " << sid << " not found\n";
+        return "Unknown field \"" + field + "\" (expected name, phone or modulecode)";
+    }
+    return string();
+}
+
+// Function to apply every update in the script `source` (- for standard input) with one load and one write
+// Updates that fail their checks are reported and skipped, and the rest are still applied
+int batchUpdate(const string& dbFile, const string& source, bool useDeltas) {
+    // Read the script
+    runStats().phase("read");
+    vector<string> script;
+    {
+        ifstream file;
+        if (source != "-") {
+            file.open(source);
+            if (!file.is_open()) {
+                cerr << "Error: Unable to open update script " << source << "\n";
+                return EXIT_FAILURE;
+            }
+        }
+        istream& ip = source == "-" ? cin : file;
+        string line;
+        while (getline(ip, line)) {
+            script.push_back(line);
+        }
+    }
+
+    DatabaseLock lock;
+    if (!lock.lock(dbFile) || !recoverJournal(dbFile)) {
+        cerr << "Error: Unable to lock database file\n";
         return EXIT_FAILURE;
     }
 
-    // Write the updated student records back to the database file
-    ofstream outFile(dbFile);
-    if (!outFile.is_open()) {
-        cerr << "Error: Unable to open database file for writing\n";
+    // Load every record once (with any changes waiting in the delta log)
+    runStats().phase("parse");
+    RecordStore db;
+    try {
+        if (!loadDatabase(dbFile, db)) {
+            cerr << "Error: Unable to open database file for reading\n";
+            return EXIT_FAILURE;
+        }
+    }
+    catch (const exception& e) {
+        cerr << "Error: Unable to read database file - " << e.what() << "\n";
         return EXIT_FAILURE;
     }
+    SourceStamp loaded;
+    if (runStats().enabled() && sourceStamp(dbFile, loaded)) {
+        runStats().parsed(loaded.size, db.size());
+    }
+
+    // Apply each update to its record, found through a SID index of the loaded records
+    runStats().phase("update");
+    unordered_map<int, size_t> positions = indexBySid(db);
+    unordered_map<size_t, Record> changed;
+    vector<Delta> applied;
+    size_t updates = 0;
+    for (size_t n = 0; n < script.size(); n++) {
+        const string& line = script[n];
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == string::npos || line[first] == '#') {
+            continue;
+        }
+        updates++;
 
-    for (const auto& record : records) {
-        outFile << "#RECORD\n";
-        outFile << " #SID\n";
-        outFile << "     " << record.getStudentID() << "\n";
-        outFile << " #NAME\n";
-        outFile << "     " << record.getName() << "\n";
-        if (!record.getPhoneNumber().empty()) {
-            outFile << " #PHONE\n";
-            outFile << "     " << record.getPhoneNumber() << "\n";
-        }
-        // Write enrollments and grades
+        Delta change;
+        string problem = parseUpdate(line, change);
+        auto found = positions.find(change.sid);
+        if (problem.empty() && found == positions.end()) {
+            problem = "Student record with ID " + to_string(change.sid) + " not found";
+        }
+        if (problem.empty()) {
+            auto record = changed.find(found->second);
+            if (record == changed.end()) {
+                record = changed.emplace(found->second, db.record(found->second)).first;
+            }
+            if (applyDelta(record->second, change)) {
+                applied.push_back(change);
+            }
+            else {
+                problem = "Cannot add a grade for " + moduleName(change.module) + " before the grades of the modules enrolled on ahead of it";
+            }
+        }
+        if (!problem.empty()) {
+            cerr << "Error: Line " << n + 1 << ": " << problem << "\n";
+        }
     }
 
-    outFile.close();
-    return EXIT_SUCCESS;
+    // Write everything at once: onto the delta log if there is one, otherwise into a rewrite of the database file
+    runStats().phase("write");
+    if (!applied.empty()) {
+        if (useDeltas || hasDeltas(dbFile)) {
+            if (!appendDeltas(dbFile, applied)) {
+                cerr << "Error: Unable to write to delta log\n";
+                return EXIT_FAILURE;
+            }
+        }
+        else {
+            // Only the changed records are written afresh, the rest of the file is copied across as it is
+            db = RecordStore();
+            unordered_map<int, const Record*> bySid;
+            unordered_set<int> sids;
+            for (const auto& [position, r] : changed) {
+                bySid[r.SID] = &r;
+                sids.insert(r.SID);
+            }
+            try {
+                rewriteDatabase(dbFile, sids, [&](Record& r) { r = *bySid[r.SID]; });
+            }
+            catch (const exception& e) {
+                cerr << "Error: Unable to write to database file - " << e.what() << "\n";
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    cout << applied.size() << " of " << updates << " updates applied\n";
+    return applied.size() == updates ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
 int main(int argc, char* argv[]) {
@@ -281,6 +481,10 @@ int main(int argc, char* argv[]) {
     string phone;
     string moduleCode;
     string grade;
+    bool useDeltas = false;
+    bool compact = false;
+    bool force = false;
+    string script;
 
     for (int i = 1; i < argc; ++i) {
         string arg = argv[i];
@@ -334,6 +538,28 @@ int main(int argc, char* argv[]) {
                 return EXIT_FAILURE;
             }
         }
+        else if (arg == "-stats") {
+            runStats().enable("updaterecord", "open");
+        }
+        else if (arg == "-delta") {
+            useDeltas = true;
+        }
+        else if (arg == "-compact") {
+            compact = true;
+        }
+        else if (arg == "-force") {
+            force = true;
+        }
+        else if (arg == "-batch") {
+            if (i + 1 < argc) {
+                script = argv[i + 1];
+                i++; // Move to the next argument
+            }
+            else {
+                cerr << "Error: Missing update script name\n";
+                return EXIT_FAILURE;
+            }
+        }
         else if (arg == "-grade") {
             if (i + 1 < argc) {
                 grade = argv[i + 1];
@@ -346,8 +572,15 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    if (compact) {
+        return compactDeltas(dbFile, force);
+    }
+    if (!script.empty()) {
+        return batchUpdate(dbFile, script, useDeltas);
+    }
+
     // Call the updateRecord function with the extracted information
-    int result = updateRecord(dbFile, sid, name, phone, moduleCode, grade);
+    int result = updateRecord(dbFile, sid, name, phone, moduleCode, grade, useDeltas);
 
     if (result == EXIT_SUCCESS) {
         cout << "Student record updated successfully!\n";
@@ -0,0 +1,89 @@
+#include "databaseloader.h"
+
+#include <algorithm>
+#include <exception>
+#include <string_view>
+#include <vector>
+#include "dbparser.h"
+#include "delta.h"
+#include "mappedfile.h"
+#include "snapshot.h"
+
+DatabaseLoader::DatabaseLoader(const QString &fileName, QObject *parent)
+    : QThread(parent)
+    , fileName(fileName)
+{
+    qRegisterMetaType<RecordChunk>();
+}
+
+void DatabaseLoader::run()
+{
+    try {
+        load();
+    }
+    catch (const std::exception &e) {
+        emit loadFailed(tr("Cannot read %1 - %2").arg(fileName, QString::fromUtf8(e.what())));
+    }
+}
+
+void DatabaseLoader::load()
+{
+    std::string name = fileName.toStdString();
+    SourceStamp stamp;
+    if (!sourceStamp(name, stamp)) {
+        emit loadFailed(tr("Cannot open %1").arg(fileName));
+        return;
+    }
+    qint64 total = static_cast<qint64>(stamp.size);
+
+    //A snapshot is a single mapping away, so there is nothing to gain from pieces
+    Snapshot snapshot;
+    if (snapshot.open(name)) {
+        snapshot.close();
+        auto records = std::make_shared<RecordStore>();
+        if (!loadDatabase(name, *records)) {
+            emit loadFailed(tr("Cannot open %1").arg(fileName));
+            return;
+        }
+        emit recordsLoaded(records, total, total);
+        emit loadFinished();
+        return;
+    }
+
+    std::vector<Delta> deltas;
+    readDeltas(name, deltas);
+    MappedFile file;
+    if (!file.open(name)) {
+        emit loadFailed(tr("Cannot open %1").arg(fileName));
+        return;
+    }
+
+    //Each piece ends where the last record that starts in it begins (or is made longer, if one record
+    //fills all of it), so no record is split between two pieces
+    std::string_view text = file.view();
+    size_t start = 0;
+    size_t lines = 0;
+    while (start < text.size()) {
+        if (isInterruptionRequested()) {
+            return;
+        }
+        size_t end = text.size();
+        for (size_t length = CHUNK_BYTES; length < text.size() - start; length *= 2) {
+            size_t tag = lastRecordTag(text.substr(start, length));
+            if (tag != std::string_view::npos && tag > 0) {
+                end = start + tag;
+                break;
+            }
+        }
+
+        std::string_view piece = text.substr(start, end - start);
+        auto records = std::make_shared<RecordStore>();
+        parseDatabase(piece, *records, lines);
+        applyDeltas(deltas, *records);
+        lines += static_cast<size_t>(std::count(piece.begin(), piece.end(), '\n'));
+        file.release(end);
+        start = end;
+        emit recordsLoaded(records, static_cast<qint64>(end), static_cast<qint64>(text.size()));
+    }
+    emit loadFinished();
+}
@@ -0,0 +1,47 @@
+#ifndef DATABASELOADER_H
+#define DATABASELOADER_H
+
+#include <QMetaType>
+#include <QString>
+#include <QThread>
+#include <memory>
+#include "recordstore.h"
+
+//Records parsed from one piece of a database, in file order
+using RecordChunk = std::shared_ptr<const RecordStore>;
+Q_DECLARE_METATYPE(RecordChunk)
+
+//Loads a database on its own thread, handing the records over a piece at a time as they are parsed
+//The pieces are about CHUNK_BYTES of text each, cut at #RECORD tags, with any changes in the delta log
+//applied. A snapshot that is up to date is loaded whole instead, which is quicker than parsing any piece.
+//The load stops between pieces once requestInterruption() has been called
+class DatabaseLoader : public QThread
+{
+    Q_OBJECT
+
+public:
+    //Text parsed before each piece is handed over
+    static const size_t CHUNK_BYTES = 4 << 20;
+
+    DatabaseLoader(const QString &fileName, QObject *parent = nullptr);
+
+signals:
+    //The next records of the file, and how much of the file has been read
+    void recordsLoaded(RecordChunk records, qint64 bytesRead, qint64 bytesTotal);
+
+    //Every record has been handed over
+    void loadFinished();
+
+    //The file could not be read. Records handed over before the problem was found stay valid
+    void loadFailed(QString problem);
+
+protected:
+    void run() override;
+
+private:
+    void load();
+
+    QString fileName;
+};
+
+#endif // DATABASELOADER_H
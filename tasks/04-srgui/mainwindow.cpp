@@ -1,15 +1,266 @@
 #include "mainwindow.h"
 #include "./ui_mainwindow.h"
 
+#include <QFileDialog>
+#include <QHeaderView>
+#include <QMessageBox>
+#include <QProgressBar>
+#include <QTimer>
+#include "namesearch.h"
+#include "recordtablemodel.h"
+
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
+    , model(new RecordTableModel(this))
+    , progress(new QProgressBar(this))
+    , nameSearch(new NameSearch)
+    , searchTimer(new QTimer(this))
 {
     ui->setupUi(this);
+    progress->setRange(0, 1000);
+    progress->setMaximumWidth(200);
+    progress->hide();
+    statusBar()->addPermanentWidget(progress);
+    ui->tableRecords->setModel(model);
+
+    //Every row the same height and no column sized to fit its contents, so the view never has to measure
+    //rows that are not on screen
+    QHeaderView *rows = ui->tableRecords->verticalHeader();
+    rows->setSectionResizeMode(QHeaderView::Fixed);
+    rows->setDefaultSectionSize(fontMetrics().height() + 6);
+    QHeaderView *columns = ui->tableRecords->horizontalHeader();
+    columns->setSectionResizeMode(QHeaderView::Interactive);
+    columns->resizeSection(RecordTableModel::SID, 100);
+    columns->resizeSection(RecordTableModel::NAME, 260);
+    columns->resizeSection(RecordTableModel::PHONE, 160);
+
+    connect(ui->action_Open_Database, &QAction::triggered, this, &MainWindow::openDatabase);
+    connect(ui->action_Close, &QAction::triggered, this, &MainWindow::closeDatabase);
+    connect(ui->actionE_xit, &QAction::triggered, this, &QWidget::close);
+    connect(ui->buttonPrev, &QPushButton::clicked, this, &MainWindow::showPrevious);
+    connect(ui->buttonNext, &QPushButton::clicked, this, &MainWindow::showNext);
+    connect(ui->tableRecords->selectionModel(), &QItemSelectionModel::currentRowChanged, this, &MainWindow::showCurrent);
+
+    //Names are indexed and looked up on a thread of their own, once typing pauses
+    nameSearch->moveToThread(&searchThread);
+    connect(&searchThread, &QThread::finished, nameSearch, &QObject::deleteLater);
+    connect(nameSearch, &NameSearch::found, this, &MainWindow::showMatches);
+    searchThread.start();
+    searchTimer->setSingleShot(true);
+    searchTimer->setInterval(SEARCH_DELAY_MS);
+    connect(searchTimer, &QTimer::timeout, this, &MainWindow::runSearch);
+    connect(ui->editSearch, &QLineEdit::textChanged, searchTimer, QOverload<>::of(&QTimer::start));
+    connect(ui->listResults, &QListWidget::currentRowChanged, this, &MainWindow::showMatch);
+
+    showRecord(-1);
 }
 
 MainWindow::~MainWindow()
 {
+    searchThread.quit();
+    searchThread.wait();
+
+    //Loads that were cancelled may still be finishing their last piece
+    for (DatabaseLoader *running : findChildren<DatabaseLoader *>()) {
+        running->requestInterruption();
+        running->wait();
+    }
     delete ui;
 }
 
+void MainWindow::openDatabase()
+{
+    QString fileName = QFileDialog::getOpenFileName(this, tr("Open Database"), QString(),
+                                                    tr("Databases (*.txt);;All files (*)"));
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    startLoad(fileName);
+}
+
+void MainWindow::closeDatabase()
+{
+    cancelLoad();
+    model->clear();
+    resetSearch();
+    setWindowTitle(tr("MainWindow"));
+    statusBar()->clearMessage();
+    showRecord(-1);
+}
+
+void MainWindow::startLoad(const QString &fileName)
+{
+    cancelLoad();
+    model->clear();
+    resetSearch();
+    showRecord(-1);
+
+    int load = ++loads;
+    loadingFile = fileName;
+    loader = new DatabaseLoader(fileName, this);
+    connect(loader, &DatabaseLoader::recordsLoaded, this,
+            [this, load](RecordChunk records, qint64 bytesRead, qint64 bytesTotal) {
+                addRecords(load, records, bytesRead, bytesTotal);
+            });
+    connect(loader, &DatabaseLoader::loadFinished, this, [this, load]() { endLoad(load, QString()); });
+    connect(loader, &DatabaseLoader::loadFailed, this, [this, load](const QString &problem) { endLoad(load, problem); });
+    connect(loader, &QThread::finished, loader, &QObject::deleteLater);
+
+    setWindowTitle(fileName);
+    progress->setValue(0);
+    progress->show();
+    statusBar()->showMessage(tr("Loading %1").arg(fileName));
+    loader->start();
+}
+
+void MainWindow::cancelLoad()
+{
+    if (loader) {
+        loader->requestInterruption();
+        loader = nullptr;
+        loads++;
+    }
+    progress->hide();
+}
+
+void MainWindow::addRecords(int load, RecordChunk records, qint64 bytesRead, qint64 bytesTotal)
+{
+    if (load != loads) {
+        return;
+    }
+    size_t firstRow = model->recordCount();
+    model->appendRecords(records);
+    QMetaObject::invokeMethod(nameSearch, "addRecords", Qt::QueuedConnection, Q_ARG(RecordChunk, records),
+                              Q_ARG(qint64, static_cast<qint64>(firstRow)));
+    progress->setValue(bytesTotal > 0 ? static_cast<int>(bytesRead * 1000 / bytesTotal) : 1000);
+    statusBar()->showMessage(tr("Loading %1: %n record(s)", nullptr, static_cast<int>(model->recordCount())).arg(loadingFile));
+
+    //The records can be browsed and searched as soon as there are any
+    if (firstRow == 0) {
+        selectRow(0);
+    }
+    else {
+        showCurrent();
+    }
+
+    //A search that found fewer than it can show may find more among the new records
+    if (matchesComplete && !ui->editSearch->text().trimmed().isEmpty()) {
+        searchTimer->start();
+    }
+}
+
+void MainWindow::endLoad(int load, const QString &problem)
+{
+    if (load != loads) {
+        return;
+    }
+    loader = nullptr;
+    progress->hide();
+    statusBar()->showMessage(tr("%n record(s)", nullptr, static_cast<int>(model->recordCount())));
+    if (!problem.isEmpty()) {
+        QMessageBox::warning(this, tr("Open Database"), problem);
+    }
+}
+
+void MainWindow::showPrevious()
+{
+    selectRow(ui->tableRecords->currentIndex().row() - 1);
+}
+
+void MainWindow::showNext()
+{
+    selectRow(ui->tableRecords->currentIndex().row() + 1);
+}
+
+void MainWindow::showCurrent()
+{
+    showRecord(ui->tableRecords->currentIndex().row());
+}
+
+void MainWindow::runSearch()
+{
+    QString text = ui->editSearch->text();
+    if (text.trimmed().isEmpty()) {
+        queries++;
+        matchesComplete = true;
+        ui->listResults->clear();
+        return;
+    }
+    nameSearch->request(++queries, text);
+}
+
+void MainWindow::showMatches(int query, QVector<int> rows, bool more)
+{
+    if (query != queries) {
+        return;
+    }
+    matchesComplete = !more;
+    ui->listResults->clear();
+    for (int row : rows) {
+        RecordView r = model->record(row);
+        QString name = QString::fromUtf8(r.name.data(), static_cast<int>(r.name.size()));
+        QListWidgetItem *item = new QListWidgetItem(QString("%1  %2").arg(r.SID).arg(name), ui->listResults);
+        item->setData(Qt::UserRole, row);
+    }
+    statusBar()->showMessage(more ? tr("First %1 matches").arg(rows.size())
+                                  : tr("%n match(es)", nullptr, static_cast<int>(rows.size())));
+}
+
+void MainWindow::showMatch()
+{
+    QListWidgetItem *item = ui->listResults->currentItem();
+    if (item) {
+        selectRow(item->data(Qt::UserRole).toInt());
+    }
+}
+
+void MainWindow::resetSearch()
+{
+    QMetaObject::invokeMethod(nameSearch, "clear", Qt::QueuedConnection);
+    queries++;
+    matchesComplete = true;
+    ui->listResults->clear();
+}
+
+void MainWindow::selectRow(int row)
+{
+    while (row >= model->rowCount() && model->canFetchMore(QModelIndex())) {
+        model->fetchMore(QModelIndex());
+    }
+    if (row < 0 || row >= model->rowCount()) {
+        return;
+    }
+    QModelIndex index = model->index(row, RecordTableModel::SID);
+    ui->tableRecords->setCurrentIndex(index);
+    ui->tableRecords->scrollTo(index);
+}
+
+void MainWindow::showRecord(int row)
+{
+    bool shown = row >= 0 && row < model->rowCount();
+    ui->buttonPrev->setEnabled(shown && row > 0);
+    ui->buttonNext->setEnabled(shown && static_cast<size_t>(row) + 1 < model->recordCount());
+    if (!shown) {
+        ui->labelSID->clear();
+        ui->labelNAME->clear();
+        ui->labelPHONE->clear();
+        ui->tableWidget->setRowCount(0);
+        return;
+    }
+
+    RecordView r = model->record(row);
+    ui->labelSID->setText(QString::number(r.SID));
+    ui->labelNAME->setText(QString::fromUtf8(r.name.data(), static_cast<int>(r.name.size())));
+    ui->labelPHONE->setText(QString::fromUtf8(r.phone.data(), static_cast<int>(r.phone.size())));
+
+    //Grades are paired with enrollments by position, and the last few modules may not have one yet
+    ui->tableWidget->setRowCount(static_cast<int>(r.enrollments.size()));
+    for (size_t n = 0; n < r.enrollments.size(); n++) {
+        int line = static_cast<int>(n);
+        ui->tableWidget->setItem(line, 0, new QTableWidgetItem(QString::fromStdString(moduleName(r.enrollments[n]))));
+        QString grade = n < r.grades.size() ? QString::number(r.grades[n], 'f', 1) : QString();
+        ui->tableWidget->setItem(line, 1, new QTableWidgetItem(grade));
+    }
+}
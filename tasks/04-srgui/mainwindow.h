@@ -2,6 +2,15 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
+#include <QPointer>
+#include <QThread>
+#include <QVector>
+#include "databaseloader.h"
+
+class NameSearch;
+class QProgressBar;
+class QTimer;
+class RecordTableModel;
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -15,7 +24,49 @@ public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
+private slots:
+    void openDatabase();
+    void closeDatabase();
+    void showPrevious();
+    void showNext();
+    void showCurrent();
+    void runSearch();
+    void showMatches(int query, QVector<int> rows, bool more);
+    void showMatch();
+
 private:
+    //Time the search box must be left alone before the name is looked up
+    static const int SEARCH_DELAY_MS = 150;
+
+    //Start loading `fileName` in the background, in place of whatever is shown or still loading
+    void startLoad(const QString &fileName);
+
+    //Stop the load in progress, if there is one. Records it has already handed over are kept
+    void cancelLoad();
+
+    //Take the next records from the load numbered `load` (ignored if another load has started since)
+    void addRecords(int load, RecordChunk records, qint64 bytesRead, qint64 bytesTotal);
+    void endLoad(int load, const QString &problem);
+
+    //Forget the records indexed for searching, and any search under way
+    void resetSearch();
+
+    //Select the record in `row` of the table, fetching rows up to it if the view has not got them yet
+    void selectRow(int row);
+
+    //Fill the labels and grades table with the record in `row` (or blank them, if it is -1)
+    void showRecord(int row);
+
     Ui::MainWindow *ui;
+    RecordTableModel *model;
+    QProgressBar *progress;
+    QPointer<DatabaseLoader> loader;
+    int loads = 0;      //Loads started, so the records of a cancelled one can be told apart
+    QString loadingFile;
+    QThread searchThread;
+    NameSearch *nameSearch;
+    QTimer *searchTimer;
+    int queries = 0;                //Searches asked for, so answers to earlier ones can be told apart
+    bool matchesComplete = true;    //Did the last answer hold every match?
 };
 #endif // MAINWINDOW_H
@@ -0,0 +1,125 @@
+#include "nameindex.h"
+
+#include <algorithm>
+
+//Append `text` to `out` in lower case, leaving out everything but letters and digits (bytes of UTF-8
+//characters outside ASCII are kept as they are)
+static void appendNormalized(std::string_view text, std::string &out)
+{
+    for (char c : text) {
+        unsigned char u = static_cast<unsigned char>(c);
+        if (u >= 'A' && u <= 'Z') {
+            out += static_cast<char>(u - 'A' + 'a');
+        }
+        else if ((u >= 'a' && u <= 'z') || (u >= '0' && u <= '9') || u >= 0x80) {
+            out += c;
+        }
+    }
+}
+
+//Call `visit` with each space-separated word of `text`
+template <typename Visitor>
+static void forEachWord(std::string_view text, Visitor visit)
+{
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t end = std::min(text.find(' ', start), text.size());
+        if (end > start) {
+            visit(text.substr(start, end - start));
+        }
+        start = end + 1;
+    }
+}
+
+std::vector<std::string> nameWords(std::string_view text)
+{
+    std::vector<std::string> words;
+    forEachWord(text, [&](std::string_view w) {
+        std::string normalized;
+        appendNormalized(w, normalized);
+        if (!normalized.empty()) {
+            words.push_back(std::move(normalized));
+        }
+    });
+    return words;
+}
+
+std::string_view NameIndex::word(const Segment &segment, const Entry &entry)
+{
+    return std::string_view(segment.words).substr(entry.offset, entry.length);
+}
+
+void NameIndex::clear()
+{
+    segments.clear();
+}
+
+void NameIndex::add(std::shared_ptr<const RecordStore> records, size_t firstRow)
+{
+    Segment segment;
+    segment.firstRow = firstRow;
+    for (size_t n = 0; n < records->size(); n++) {
+        forEachWord((*records)[n].name, [&](std::string_view w) {
+            size_t offset = segment.words.size();
+            appendNormalized(w, segment.words);
+            if (segment.words.size() > offset) {
+                segment.entries.push_back({static_cast<uint32_t>(offset),
+                                           static_cast<uint32_t>(segment.words.size() - offset),
+                                           static_cast<uint32_t>(n)});
+            }
+        });
+    }
+    std::sort(segment.entries.begin(), segment.entries.end(), [&](const Entry &a, const Entry &b) {
+        return word(segment, a) < word(segment, b);
+    });
+    segment.records = std::move(records);
+    segments.push_back(std::move(segment));
+}
+
+bool NameIndex::find(std::string_view query, std::vector<size_t> &rows, size_t limit) const
+{
+    rows.clear();
+    std::vector<std::string> wanted = nameWords(query);
+    if (wanted.empty()) {
+        return true;
+    }
+
+    //The longest word is looked up in the index, as it has the fewest matches, and the others are
+    //checked against the names of the records it finds
+    auto longest = std::max_element(wanted.begin(), wanted.end(),
+                                    [](const std::string &a, const std::string &b) { return a.size() < b.size(); });
+    std::string key = *longest;
+    wanted.erase(longest);
+
+    std::vector<uint32_t> candidates;
+    for (const Segment &segment : segments) {
+        candidates.clear();
+        auto it = std::lower_bound(segment.entries.begin(), segment.entries.end(), key,
+                                   [&](const Entry &e, const std::string &k) { return word(segment, e) < k; });
+        for (; it != segment.entries.end() && word(segment, *it).substr(0, key.size()) == key; ++it) {
+            candidates.push_back(it->record);
+        }
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+        for (uint32_t record : candidates) {
+            bool matches = true;
+            if (!wanted.empty()) {
+                std::vector<std::string> words = nameWords((*segment.records)[record].name);
+                for (const std::string &w : wanted) {
+                    matches = matches && std::any_of(words.begin(), words.end(), [&](const std::string &have) {
+                        return have.compare(0, w.size(), w) == 0;
+                    });
+                }
+            }
+            if (!matches) {
+                continue;
+            }
+            if (rows.size() == limit) {
+                return false;
+            }
+            rows.push_back(segment.firstRow + record);
+        }
+    }
+    return true;
+}
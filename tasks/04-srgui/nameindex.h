@@ -0,0 +1,55 @@
+#ifndef NAMEINDEX_H
+#define NAMEINDEX_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "recordstore.h"
+
+//Index of the words of every student's name, for finding records from the first letters of a name
+//The words are normalized (lower case, only letters and digits, so "O'Neil" is found by "onei") and kept
+//sorted, so the words starting with a prefix are one binary search away. The index is built a piece at
+//a time, one segment per RecordStore added (see DatabaseLoader), and segments are searched in file order
+class NameIndex
+{
+public:
+    //Forget every record
+    void clear();
+
+    //Index the records of `records`, which are shown from row `firstRow` on
+    //The store must not change while it is indexed
+    void add(std::shared_ptr<const RecordStore> records, size_t firstRow);
+
+    //Find the records that have a name word starting with each word of `query` ("jo smi" finds Jo Smith and
+    //John Smithers), and put the rows of the first `limit` of them in `rows`, in file order
+    //Returns false if there were more than `limit`
+    bool find(std::string_view query, std::vector<size_t>& rows, size_t limit) const;
+
+private:
+    //One word of one record's name
+    struct Entry {
+        uint32_t offset;    //Normalized word in the segment's `words`
+        uint32_t length;
+        uint32_t record;    //Record in the segment's store
+    };
+
+    struct Segment {
+        std::shared_ptr<const RecordStore> records;
+        size_t firstRow = 0;
+        std::string words;              //Every normalized word, back to back
+        std::vector<Entry> entries;     //Sorted by word
+    };
+
+    static std::string_view word(const Segment &segment, const Entry &entry);
+
+    std::vector<Segment> segments;
+};
+
+//Functions
+
+//Split `text` into its normalized words (see NameIndex)
+std::vector<std::string> nameWords(std::string_view text);
+
+#endif // NAMEINDEX_H
@@ -0,0 +1,41 @@
+#include "namesearch.h"
+
+#include <vector>
+
+NameSearch::NameSearch(QObject *parent)
+    : QObject(parent)
+{
+    qRegisterMetaType<RecordChunk>();
+    qRegisterMetaType<QVector<int>>();
+}
+
+void NameSearch::request(int query, const QString &text)
+{
+    latest = query;
+    QMetaObject::invokeMethod(this, "search", Qt::QueuedConnection, Q_ARG(int, query), Q_ARG(QString, text));
+}
+
+void NameSearch::clear()
+{
+    index.clear();
+}
+
+void NameSearch::addRecords(RecordChunk records, qint64 firstRow)
+{
+    index.add(std::move(records), static_cast<size_t>(firstRow));
+}
+
+void NameSearch::search(int query, const QString &text)
+{
+    if (query < latest) {
+        return;
+    }
+    std::vector<size_t> rows;
+    bool complete = index.find(text.toStdString(), rows, MAX_MATCHES);
+    QVector<int> matches;
+    matches.reserve(static_cast<int>(rows.size()));
+    for (size_t row : rows) {
+        matches.append(static_cast<int>(row));
+    }
+    emit found(query, matches, !complete);
+}
@@ -0,0 +1,44 @@
+#ifndef NAMESEARCH_H
+#define NAMESEARCH_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include "databaseloader.h"
+#include "nameindex.h"
+
+//Answers name searches from a NameIndex on its own thread (the object is moved to a QThread that only it uses)
+//Records are indexed as they are loaded, so searches can be made before the load has finished.
+//Only the latest search is answered: any still waiting when a newer one is asked for are dropped
+class NameSearch : public QObject
+{
+    Q_OBJECT
+
+public:
+    //Matches sent back for each search
+    static const int MAX_MATCHES = 200;
+
+    explicit NameSearch(QObject *parent = nullptr);
+
+    //Ask for the records whose name matches `text` (see NameIndex::find). Safe to call from any thread.
+    //The answer comes back through found() with the same `query`, which must be larger than any asked before
+    void request(int query, const QString &text);
+
+public slots:
+    void clear();
+    void addRecords(RecordChunk records, qint64 firstRow);
+
+signals:
+    //Rows of the records matching search `query`, in file order. `more` is set if there were more than MAX_MATCHES
+    void found(int query, QVector<int> rows, bool more);
+
+private slots:
+    void search(int query, const QString &text);
+
+private:
+    NameIndex index;
+    std::atomic<int> latest{0};
+};
+
+#endif // NAMESEARCH_H
@@ -0,0 +1,122 @@
+#include "recordtablemodel.h"
+
+#include <algorithm>
+#include <climits>
+
+RecordTableModel::RecordTableModel(QObject *parent)
+    : QAbstractTableModel(parent)
+{
+}
+
+void RecordTableModel::clear()
+{
+    beginResetModel();
+    chunks.clear();
+    chunkStarts.clear();
+    records = 0;
+    fetched = 0;
+    endResetModel();
+}
+
+void RecordTableModel::appendRecords(std::shared_ptr<const RecordStore> chunk)
+{
+    if (!chunk || chunk->empty()) {
+        return;
+    }
+    chunkStarts.push_back(records);
+    records += chunk->size();
+    chunks.push_back(std::move(chunk));
+
+    //The view only asks for more rows when it is scrolled to the end of those it has, so the first rows
+    //are given to it straight away
+    if (fetched == 0) {
+        fetchMore(QModelIndex());
+    }
+}
+
+size_t RecordTableModel::recordCount() const
+{
+    //A QModelIndex can only address INT_MAX rows
+    return std::min<size_t>(records, INT_MAX);
+}
+
+RecordView RecordTableModel::record(int row) const
+{
+    size_t n = static_cast<size_t>(row);
+    size_t chunk = static_cast<size_t>(std::upper_bound(chunkStarts.begin(), chunkStarts.end(), n) - chunkStarts.begin()) - 1;
+    return (*chunks[chunk])[n - chunkStarts[chunk]];
+}
+
+int RecordTableModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : fetched;
+}
+
+int RecordTableModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : COLUMNS;
+}
+
+QVariant RecordTableModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= fetched) {
+        return QVariant();
+    }
+    if (role == Qt::TextAlignmentRole) {
+        return index.column() == SID || index.column() == MODULES
+               ? QVariant(int(Qt::AlignRight | Qt::AlignVCenter)) : QVariant();
+    }
+    if (role != Qt::DisplayRole) {
+        return QVariant();
+    }
+
+    RecordView r = record(index.row());
+    switch (index.column()) {
+    case SID:
+        return r.SID;
+    case NAME:
+        return QString::fromUtf8(r.name.data(), static_cast<int>(r.name.size()));
+    case PHONE:
+        return QString::fromUtf8(r.phone.data(), static_cast<int>(r.phone.size()));
+    case MODULES:
+        return static_cast<int>(r.enrollments.size());
+    }
+    return QVariant();
+}
+
+QVariant RecordTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QAbstractTableModel::headerData(section, orientation, role);
+    }
+    switch (section) {
+    case SID:
+        return tr("Student ID");
+    case NAME:
+        return tr("Name");
+    case PHONE:
+        return tr("Phone");
+    case MODULES:
+        return tr("Modules");
+    }
+    return QVariant();
+}
+
+bool RecordTableModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && static_cast<size_t>(fetched) < recordCount();
+}
+
+void RecordTableModel::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid()) {
+        return;
+    }
+    int more = static_cast<int>(std::min<size_t>(FETCH_ROWS, recordCount() - static_cast<size_t>(fetched)));
+    if (more <= 0) {
+        return;
+    }
+    beginInsertRows(QModelIndex(), fetched, fetched + more - 1);
+    fetched += more;
+    endInsertRows();
+}
@@ -0,0 +1,53 @@
+#ifndef RECORDTABLEMODEL_H
+#define RECORDTABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <memory>
+#include <vector>
+#include "recordstore.h"
+
+//Every record of a database, one per row, for a QTableView
+//The records are held in the RecordStores they were loaded into, one per piece of the file (see DatabaseLoader),
+//and nothing is copied out of them: the text of a cell is only made when the view asks for it in data(),
+//which it does for the rows on screen, and rows are handed to the view FETCH_ROWS at a time as it scrolls
+//down (canFetchMore / fetchMore), so neither drawing nor scrolling depends on the size of the database
+class RecordTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column { SID, NAME, PHONE, MODULES, COLUMNS };
+
+    //Rows added to the view each time it scrolls to the end of those it has
+    static const int FETCH_ROWS = 2000;
+
+    explicit RecordTableModel(QObject *parent = nullptr);
+
+    //Show no records
+    void clear();
+
+    //Show the records of `chunk` after those already shown. The chunk must not change while it is shown
+    void appendRecords(std::shared_ptr<const RecordStore> chunk);
+
+    //Number of records, including those not yet fetched by the view
+    size_t recordCount() const;
+
+    //Record shown in `row`. Only valid until clear() is called
+    RecordView record(int row) const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+private:
+    std::vector<std::shared_ptr<const RecordStore>> chunks;
+    std::vector<size_t> chunkStarts;    //Row of the first record of each chunk
+    size_t records = 0;
+    int fetched = 0;                    //Rows the view has been given
+};
+
+#endif // RECORDTABLEMODEL_H
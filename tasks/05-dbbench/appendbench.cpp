@@ -0,0 +1,204 @@
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include "generator.h"
+#include "numparse.h"
+#include "recordstore.h"
+#include "snapshot.h"
+using namespace std;
+
+/*
+ * Runs many addrecord processes against one database at once, and checks that nothing was lost or added twice
+ *
+ *  appendbench [-writers <n1,n2,...>] [-records <n>] [-base <n>] [-dir <scratch directory>] [-addrecord <path>]
+ *
+ * -writers <n1,n2,...>  Numbers of addrecord processes running at the same time (default 1,8,64)
+ * -records <n>          Records submitted at each number of writers (default 512)
+ * -base <n>             Records in the database before they start (default 1000)
+ * -dir <directory>      Where the database is written (default the current directory). It is removed afterwards
+ * -addrecord <path>     The program to run (default the one built alongside appendbench)
+ *
+ * Every eighth submission reuses a student ID: alternately one already in the database, which must be
+ * refused, and the one submitted just before it (possibly still in flight), where exactly one of the two
+ * must be added. Afterwards the database is parsed, and every student ID must appear exactly once.
+ * The results are written to the terminal as CSV, one line per number of writers:
+ *
+ *  writers,submitted,added,refused,seconds,inserts_per_second,lost_or_duplicated
+ *
+ * The exit code is EXIT_FAILURE if any record was lost or added twice.
+ */
+
+#ifndef ADDRECORD_PATH
+#define ADDRECORD_PATH "addrecord"
+#endif
+
+#ifdef _WIN32
+const char* const DISCARD_OUTPUT = " >NUL 2>&1";
+#else
+const char* const DISCARD_OUTPUT = " >/dev/null 2>&1";
+#endif
+
+//One submission in every DUPLICATE_EVERY reuses a student ID
+const size_t DUPLICATE_EVERY = 8;
+
+int findArg(int argc, char* argv[], string pattern);
+
+//Read a comma separated list of numbers > 0
+static bool readList(const string& text, vector<size_t>& values)
+{
+    values.clear();
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t comma = min(text.find(',', start), text.size());
+        int value = 0;
+        if (!parseInt(string_view(text).substr(start, comma - start), value).ok() || value <= 0) {
+            return false;
+        }
+        values.push_back(static_cast<size_t>(value));
+        start = comma + 1;
+    }
+    return !values.empty();
+}
+
+//Read a whole number > 0 that follows option `name`
+static bool readCount(int argc, char* argv[], const string& name, int& value)
+{
+    int p = findArg(argc, argv, name);
+    if (!p) {
+        return true;
+    }
+    if (p == argc - 1 || !parseInt(argv[p + 1], value).ok() || value <= 0) {
+        cerr << "Error: " << name << " needs a whole number greater than 0" << endl;
+        return false;
+    }
+    return true;
+}
+
+//Value that follows option `name`, or `fallback`
+static string readOption(int argc, char* argv[], const string& name, const string& fallback)
+{
+    int p = findArg(argc, argv, name);
+    return p && p < argc - 1 ? argv[p + 1] : fallback;
+}
+
+int main(int argc, char* argv[])
+{
+    vector<size_t> writerCounts = {1, 8, 64};
+    int records = 512;
+    int base = 1000;
+    int p = findArg(argc, argv, "-writers");
+    if (p && (p == argc - 1 || !readList(argv[p + 1], writerCounts))) {
+        cerr << "Usage: appendbench [-writers <n1,n2,...>] [-records <n>] [-base <n>] [-dir <scratch directory>]" << endl;
+        return EXIT_FAILURE;
+    }
+    if (!readCount(argc, argv, "-records", records) || !readCount(argc, argv, "-base", base)) {
+        return EXIT_FAILURE;
+    }
+    filesystem::path dir = readOption(argc, argv, "-dir", ".");
+    string addrecord = "\"" + readOption(argc, argv, "-addrecord", ADDRECORD_PATH) + "\"";
+    filesystem::path db = dir / "appendbench.txt";
+
+    //The student ID of each submission
+    size_t existing = static_cast<size_t>(base);
+    vector<int> sids(static_cast<size_t>(records));
+    for (size_t i = 0; i < sids.size(); i++) {
+        sids[i] = generatedSid(0, existing) + base + static_cast<int>(i);
+        if (i % DUPLICATE_EVERY == DUPLICATE_EVERY - 1) {
+            sids[i] = (i / DUPLICATE_EVERY) % 2 == 0 ? generatedSid(i % existing, existing) : sids[i - 1];
+        }
+    }
+
+    bool allGood = true;
+    cout << "writers,submitted,added,refused,seconds,inserts_per_second,lost_or_duplicated" << endl;
+    for (size_t writers : writerCounts) {
+        {
+            ofstream op(db, ios::binary | ios::trunc);
+            GeneratorOptions options;
+            options.records = existing;
+            generateDatabase(op, options);
+        }
+
+        //Each writer thread runs one addrecord after another, taking the next submission each time
+        vector<char> added(sids.size(), 0);
+        atomic<size_t> next{0};
+        auto writer = [&]() {
+            for (size_t i = next++; i < sids.size(); i = next++) {
+                string command = addrecord + " -db \"" + db.string() + "\" -sid " + to_string(sids[i])
+                                 + " -phone 44-1234-567890 -modulecodes COMP101 COMP102 -grades 55.5 62.0 -name Bench Student";
+                added[i] = system((command + DISCARD_OUTPUT).c_str()) == 0;
+            }
+        };
+        auto start = chrono::steady_clock::now();
+        vector<thread> threads;
+        for (size_t t = 0; t < writers; t++) {
+            threads.emplace_back(writer);
+        }
+        for (thread& t : threads) {
+            t.join();
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        //Exactly one submission of each new student ID must have succeeded, and none of an existing one
+        map<int, size_t> successes;
+        for (size_t n = 0; n < existing; n++) {
+            successes[generatedSid(n, existing)] = 1;
+        }
+        size_t addedCount = 0;
+        for (size_t i = 0; i < sids.size(); i++) {
+            successes[sids[i]] += static_cast<size_t>(added[i]);
+            addedCount += static_cast<size_t>(added[i]);
+        }
+        map<int, size_t> found;
+        RecordStore store;
+        try {
+            loadDatabase(db.string(), store);
+        }
+        catch (const exception& e) {
+            cerr << "Error: " << db.string() << " no longer parses - " << e.what() << endl;
+        }
+        for (int sid : store.sidColumn()) {
+            found[sid]++;
+        }
+        size_t wrong = 0;
+        for (const auto& [sid, count] : successes) {
+            auto f = found.find(sid);
+            size_t inFile = f == found.end() ? 0 : f->second;
+            if (count != 1 || inFile != 1) {
+                cerr << "Student ID " << sid << ": " << count << " successful submissions or original records, "
+                     << inFile << " in the database" << endl;
+                wrong++;
+            }
+        }
+        wrong += found.size() - min(found.size(), successes.size());
+        allGood = allGood && wrong == 0;
+
+        cout << writers << ',' << sids.size() << ',' << addedCount << ',' << sids.size() - addedCount << ','
+             << seconds << ',' << addedCount / seconds << ',' << wrong << endl;
+
+        filesystem::remove(db);
+        filesystem::remove(db.string() + ".lock");
+        filesystem::remove_all(db.string() + ".journal");
+    }
+    return allGood ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int findArg(int argc, char* argv[], string pattern)
+{
+    for (int n = 1; n < argc; n++)
+    {
+        string s1(argv[n]);
+        if (s1 == pattern)
+        {
+            return n;
+        }
+    }
+    return 0;
+}
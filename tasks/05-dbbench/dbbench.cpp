@@ -0,0 +1,263 @@
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "generator.h"
+#include "numparse.h"
+using namespace std;
+
+/*
+ * Times querydb, addrecord and updaterecord on generated databases of several sizes
+ *
+ *  dbbench [-sizes <n1,n2,...>] [-runs <n>] [-seed <s>] [-dir <scratch directory>]
+ *          [-querydb <path>] [-addrecord <path>] [-updaterecord <path>]
+ *
+ * -sizes <n1,n2,...>   Numbers of records to test with (default 1000,10000,100000,1000000)
+ * -runs <n>            Times each operation is run at each size (default 3)
+ * -seed <s>            Seed for the generated databases (default 1)
+ * -dir <directory>     Where the databases are written (default the current directory). They are removed afterwards
+ * -querydb <path> ...  The programs to time (default the ones built alongside dbbench)
+ *
+ * Each program is run as a separate process, exactly as a user would run it, so the times include starting
+ * the program. Mutating operations start from a fresh copy of the database every run. The results are
+ * written to the terminal as CSV, one line per size and operation:
+ *
+ *  records,bytes,operation,runs,failures,best_seconds,mean_seconds
+ *
+ * Operations:
+ *  generate        Writing the database with the generator (in this process, once)
+ *  load            querydb -db <file>                  Parse the whole database
+ *  lookup          querydb -db <file> -sid <id>        Find one record by scanning
+ *  lookup_indexed  querydb -db <file> -sid <id>        Find one record through a SID index (-buildindex)
+ *  batch_lookup    querydb -db <file> -sids <file>     Find 1000 records in one run
+ *  append          addrecord -db <file> -sid <id> ...  Add a new record
+ *  update          updaterecord -db <file> -sid <id> -phone ...
+ */
+
+#ifndef QUERYDB_PATH
+#define QUERYDB_PATH "querydb"
+#endif
+#ifndef ADDRECORD_PATH
+#define ADDRECORD_PATH "addrecord"
+#endif
+#ifndef UPDATERECORD_PATH
+#define UPDATERECORD_PATH "updaterecord"
+#endif
+
+#ifdef _WIN32
+const char* const DISCARD_OUTPUT = " >NUL 2>&1";
+#else
+const char* const DISCARD_OUTPUT = " >/dev/null 2>&1";
+#endif
+
+//Number of IDs looked up by batch_lookup
+const size_t BATCH_IDS = 1000;
+
+int findArg(int argc, char* argv[], string pattern);
+
+//Times of one operation
+struct Timing {
+    size_t runs = 0;
+    size_t failures = 0;
+    double best = 0;
+    double total = 0;
+
+    void add(double seconds, bool ok)
+    {
+        best = runs == 0 ? seconds : min(best, seconds);
+        total += seconds;
+        runs++;
+        failures += !ok;
+    }
+};
+
+//`path` in quotes, for a command line
+static string quoted(const string& path)
+{
+    return "\"" + path + "\"";
+}
+
+//Run `command` with its output thrown away, and say how long it took and whether it succeeded
+static double runCommand(const string& command, bool& ok)
+{
+    auto start = chrono::steady_clock::now();
+    int status = system((command + DISCARD_OUTPUT).c_str());
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    ok = status == 0;
+    if (!ok) {
+        cerr << "Failed (status " << status << "): " << command << endl;
+    }
+    return seconds;
+}
+
+//Write one line of results
+static void report(size_t records, uintmax_t bytes, const string& operation, const Timing& t)
+{
+    cout << records << ',' << bytes << ',' << operation << ',' << t.runs << ',' << t.failures << ','
+         << t.best << ',' << (t.runs > 0 ? t.total / t.runs : 0) << endl;
+}
+
+//Read a comma separated list of record counts
+static bool readSizes(const string& text, vector<size_t>& sizes)
+{
+    sizes.clear();
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t comma = min(text.find(',', start), text.size());
+        string item = text.substr(start, comma - start);
+        int value = 0;
+        NumberResult result = parseInt(item, value);
+        if (!result.ok() || value <= 0) {
+            cerr << "Error: " << (result.ok() ? "Invalid database size " + item : numberErrorMessage(result, item, "database size")) << endl;
+            return false;
+        }
+        sizes.push_back(static_cast<size_t>(value));
+        start = comma + 1;
+    }
+    return true;
+}
+
+//Read a whole number > 0 that follows option `name`
+static bool readCount(int argc, char* argv[], const string& name, int& value)
+{
+    int p = findArg(argc, argv, name);
+    if (!p) {
+        return true;
+    }
+    NumberResult result;
+    if (p == argc - 1 || !(result = parseInt(argv[p + 1], value)).ok() || value <= 0) {
+        cerr << "Error: Please provide a whole number greater than 0 after " << name << endl;
+        return false;
+    }
+    return true;
+}
+
+//Value that follows option `name`, or `fallback`
+static string readOption(int argc, char* argv[], const string& name, const string& fallback)
+{
+    int p = findArg(argc, argv, name);
+    return p && p < argc - 1 ? argv[p + 1] : fallback;
+}
+
+int main(int argc, char* argv[])
+{
+    vector<size_t> sizes = {1000, 10000, 100000, 1000000};
+    int runs = 3;
+    int seed = 1;
+    int p = findArg(argc, argv, "-sizes");
+    if (p && (p == argc - 1 || !readSizes(argv[p + 1], sizes))) {
+        cerr << "Usage: dbbench [-sizes <n1,n2,...>] [-runs <n>] [-seed <s>] [-dir <scratch directory>]" << endl;
+        return EXIT_FAILURE;
+    }
+    if (!readCount(argc, argv, "-runs", runs) || !readCount(argc, argv, "-seed", seed)) {
+        return EXIT_FAILURE;
+    }
+    filesystem::path dir = readOption(argc, argv, "-dir", ".");
+    string querydb = quoted(readOption(argc, argv, "-querydb", QUERYDB_PATH));
+    string addrecord = quoted(readOption(argc, argv, "-addrecord", ADDRECORD_PATH));
+    string updaterecord = quoted(readOption(argc, argv, "-updaterecord", UPDATERECORD_PATH));
+
+    cout << "records,bytes,operation,runs,failures,best_seconds,mean_seconds" << endl;
+    for (size_t records : sizes) {
+        filesystem::path original = dir / ("dbbench-" + to_string(records) + ".txt");
+        filesystem::path work = dir / ("dbbench-" + to_string(records) + "-work.txt");
+        filesystem::path ids = dir / ("dbbench-" + to_string(records) + "-ids.txt");
+        string db = quoted(original.string());
+
+        //Write the database
+        Timing generate;
+        {
+            auto start = chrono::steady_clock::now();
+            ofstream op(original, ios::binary);
+            GeneratorOptions options;
+            options.records = records;
+            options.seed = static_cast<uint64_t>(seed);
+            generateDatabase(op, options);
+            op.close();
+            generate.add(chrono::duration<double>(chrono::steady_clock::now() - start).count(), op.good());
+        }
+        uintmax_t bytes = filesystem::file_size(original);
+        report(records, bytes, "generate", generate);
+
+        //IDs spread through the file: one from the middle, and a batch of them
+        string middleSid = to_string(generatedSid(records / 2, records));
+        {
+            ofstream op(ids);
+            for (size_t n = 0; n < BATCH_IDS; n++) {
+                op << generatedSid(n * records / BATCH_IDS, records) << "\n";
+            }
+        }
+
+        //Read-only operations use the original file
+        bool ok;
+        Timing load, lookup, indexed, batch;
+        for (int r = 0; r < runs; r++) {
+            double seconds = runCommand(querydb + " -db " + db, ok);
+            load.add(seconds, ok);
+        }
+        for (int r = 0; r < runs; r++) {
+            double seconds = runCommand(querydb + " -db " + db + " -sid " + middleSid, ok);
+            lookup.add(seconds, ok);
+        }
+        for (int r = 0; r < runs; r++) {
+            double seconds = runCommand(querydb + " -db " + db + " -sids " + quoted(ids.string()), ok);
+            batch.add(seconds, ok);
+        }
+        runCommand(querydb + " -db " + db + " -buildindex", ok);
+        for (int r = 0; r < runs; r++) {
+            double seconds = runCommand(querydb + " -db " + db + " -sid " + middleSid, ok);
+            indexed.add(seconds, ok);
+        }
+        report(records, bytes, "load", load);
+        report(records, bytes, "lookup", lookup);
+        report(records, bytes, "lookup_indexed", indexed);
+        report(records, bytes, "batch_lookup", batch);
+
+        //Operations that change the database start from a fresh copy each time
+        Timing append, update;
+        string workDb = quoted(work.string());
+        for (int r = 0; r < runs; r++) {
+            filesystem::copy_file(original, work, filesystem::copy_options::overwrite_existing);
+            string newSid = to_string(generatedSid(0, records) + static_cast<int>(records) + r);
+            double seconds = runCommand(addrecord + " -db " + workDb + " -sid " + newSid
+                                        + " -name Bench Student -phone 44-1234-567890 -modulecodes COMP101 COMP102 -grades 55.5 62.0", ok);
+            append.add(seconds, ok);
+        }
+        for (int r = 0; r < runs; r++) {
+            filesystem::copy_file(original, work, filesystem::copy_options::overwrite_existing);
+            //updaterecord always wants a name, as one argument with two spaces after the first word
+            double seconds = runCommand(updaterecord + " -db " + workDb + " -sid " + middleSid
+                                        + " -name \"Bench  Student\" -phone 44-9876-543210", ok);
+            update.add(seconds, ok);
+        }
+        report(records, bytes, "append", append);
+        report(records, bytes, "update", update);
+
+        //Tidy up, including any index, snapshot, lock or journal the tools made
+        for (const filesystem::path& file : {original, work, ids}) {
+            filesystem::remove(file);
+            filesystem::remove(file.string() + ".idx");
+            filesystem::remove(file.string() + ".snap");
+            filesystem::remove(file.string() + ".lock");
+            filesystem::remove_all(file.string() + ".journal");
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+int findArg(int argc, char* argv[], string pattern)
+{
+    for (int n = 1; n < argc; n++)
+    {
+        string s1(argv[n]);
+        if (s1 == pattern)
+        {
+            return n;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,96 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include "generator.h"
+#include "numparse.h"
+using namespace std;
+
+/*
+ * Writes a synthetic database for testing and benchmarking the other tools
+ *
+ *  gendb -db <database file> -records <n> [-seed <s>]
+ *
+ * -db <database file>  File to create (an existing file is replaced)
+ * -records <n>         Number of records to write
+ * -seed <s>            Seed of the random numbers (default 1). The same seed always gives the same file
+ *
+ * Student IDs run from 10000 to 10000 + n - 1, in a scattered order.
+ *
+ * ****************
+ * *** EXAMPLES ***
+ * ****************
+ * gendb -db big.txt -records 1000000            A database of a million students
+ * gendb -db small.txt -records 1000 -seed 7     A different set of a thousand students
+ */
+
+int findArg(int argc, char* argv[], string pattern);
+
+//Read a whole number >= 0 that follows option `name`, or explain why there isn't one
+static bool readCount(int argc, char* argv[], const string& name, int& value)
+{
+    int p = findArg(argc, argv, name);
+    if (!p) {
+        return true;
+    }
+    if (p == argc - 1) {
+        cerr << "Error: Missing value after " << name << endl;
+        return false;
+    }
+    NumberResult result = parseInt(argv[p + 1], value);
+    if (!result.ok()) {
+        cerr << "Error: " << numberErrorMessage(result, argv[p + 1], name.substr(1)) << endl;
+        return false;
+    }
+    if (value < 0) {
+        cerr << "Error: " << name << " cannot be negative" << endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    int p = findArg(argc, argv, "-db");
+    if (!p || p == argc - 1 || !findArg(argc, argv, "-records")) {
+        cerr << "Usage: gendb -db <database file> -records <n> [-seed <s>]" << endl;
+        return EXIT_FAILURE;
+    }
+    string dataBaseName = argv[p + 1];
+
+    int records = 0;
+    int seed = 1;
+    if (!readCount(argc, argv, "-records", records) || !readCount(argc, argv, "-seed", seed)) {
+        return EXIT_FAILURE;
+    }
+
+    ofstream op(dataBaseName, ios::binary);
+    if (!op.is_open()) {
+        cerr << "Error: Cannot create file " << dataBaseName << endl;
+        return EXIT_FAILURE;
+    }
+    GeneratorOptions options;
+    options.records = static_cast<size_t>(records);
+    options.seed = static_cast<uint64_t>(seed);
+    generateDatabase(op, options);
+    op.close();
+    if (!op) {
+        cerr << "Error: Unable to write " << dataBaseName << endl;
+        return EXIT_FAILURE;
+    }
+
+    cout << records << " records written to " << dataBaseName << endl;
+    return EXIT_SUCCESS;
+}
+
+int findArg(int argc, char* argv[], string pattern)
+{
+    for (int n = 1; n < argc; n++)
+    {
+        string s1(argv[n]);
+        if (s1 == pattern)
+        {
+            return n;
+        }
+    }
+    return 0;
+}
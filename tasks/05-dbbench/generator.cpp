@@ -0,0 +1,204 @@
+#include "generator.h"
+#include <charconv>
+#include <string>
+#include <string_view>
+using namespace std;
+
+//Random numbers from SplitMix64 - small, fast, and the same everywhere
+class Random {
+public:
+    explicit Random(uint64_t seed) : state(seed) {}
+
+    uint64_t next()
+    {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    //A number from 0 to range-1
+    unsigned below(unsigned range) { return static_cast<unsigned>(next() % range); }
+
+private:
+    uint64_t state;
+};
+
+static const char* const FIRST_NAMES[] = {
+    "Jo", "Bee", "Gee", "Sam", "Alex", "Ruth", "Omar", "Priya", "Tom", "Aisha", "Ben", "Chloe",
+    "Dev", "Ella", "Finn", "Grace", "Hugo", "Isla", "Jack", "Kate", "Liam", "Maya", "Noah", "Olu",
+    "Pete", "Rosa", "Sean", "Tara", "Uma", "Vic", "Will", "Zoe"};
+static const char* const LAST_NAMES[] = {
+    "Blunt", "Hyve", "Rafferty", "Smith", "Jones", "Taylor", "Brown", "Williams", "Wilson", "Johnson",
+    "Davies", "Patel", "Robinson", "Wright", "Thompson", "Evans", "Walker", "White", "Roberts", "Green",
+    "Hall", "Wood", "Jackson", "Clarke", "Khan", "Hughes", "Edwards", "Lewis", "Turner", "Hill",
+    "Moore", "Cooper"};
+static const char* const SUBJECTS[] = {"COMP", "COMP", "COMP", "ELEC", "MATH", "PHYS", "PROJ", "GIT"};
+
+//How many students take 1, 2 ... 8 modules, out of 100
+static const unsigned ENROLLMENT_WEIGHTS[] = {2, 3, 5, 12, 30, 30, 12, 6};
+
+const size_t MAX_MODULES = sizeof(ENROLLMENT_WEIGHTS) / sizeof(ENROLLMENT_WEIGHTS[0]);
+
+//Lowest generated student ID
+const int FIRST_SID = 10000;
+
+template <typename T, size_t N>
+static constexpr unsigned countOf(const T (&)[N])
+{
+    return N;
+}
+
+static size_t gcd(size_t a, size_t b)
+{
+    while (b != 0) {
+        size_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+//Step through 0 .. records-1 that visits every value once, in a scattered order
+static size_t sidStride(size_t records)
+{
+    size_t stride = records / 2 + records / 8 + 1;
+    while (gcd(stride, records) != 1) {
+        stride++;
+    }
+    return stride;
+}
+
+int generatedSid(size_t n, size_t records)
+{
+    if (records <= 1) {
+        return FIRST_SID;
+    }
+    return FIRST_SID + static_cast<int>((n * sidStride(records)) % records);
+}
+
+//Text of a database being generated, passed to the stream in large blocks
+class Output {
+public:
+    explicit Output(ostream& op) : op(op) {}
+    ~Output() { flush(); }
+
+    Output& operator<<(string_view text)
+    {
+        buffer.append(text.data(), text.size());
+        if (buffer.size() >= BLOCK_SIZE) {
+            flush();
+        }
+        return *this;
+    }
+
+    Output& operator<<(unsigned value)
+    {
+        char digits[16];
+        auto [end, ec] = to_chars(digits, digits + sizeof(digits), value);
+        return *this << string_view(digits, end - digits);
+    }
+
+    Output& operator<<(int value)
+    {
+        char digits[16];
+        auto [end, ec] = to_chars(digits, digits + sizeof(digits), value);
+        return *this << string_view(digits, end - digits);
+    }
+
+    void flush()
+    {
+        op.write(buffer.data(), static_cast<streamsize>(buffer.size()));
+        buffer.clear();
+    }
+
+private:
+    static const size_t BLOCK_SIZE = 1 << 20;
+    ostream& op;
+    string buffer;
+};
+
+//Tags of a record, in the order they are written
+enum Tag { SID, NAME, ENROLLMENTS, GRADES, PHONE };
+
+void generateDatabase(ostream& op, const GeneratorOptions& options)
+{
+    Random random(options.seed);
+    Output out(op);
+    size_t stride = sidStride(options.records);
+
+    unsigned modules[MAX_MODULES];
+    for (size_t n = 0; n < options.records; n++) {
+        //Pick the contents of the record
+        unsigned moduleCount = 1;
+        for (unsigned pick = random.below(100); pick >= ENROLLMENT_WEIGHTS[moduleCount - 1]; moduleCount++) {
+            pick -= ENROLLMENT_WEIGHTS[moduleCount - 1];
+        }
+        for (unsigned m = 0; m < moduleCount; m++) {
+            //Each module code once - a repeated one is drawn again
+            unsigned code;
+            bool repeated;
+            do {
+                code = random.below(countOf(SUBJECTS)) * 1000 + 101 + random.below(80);
+                repeated = false;
+                for (unsigned k = 0; k < m; k++) {
+                    repeated |= modules[k] == code;
+                }
+            } while (repeated);
+            modules[m] = code;
+        }
+        //Some students are part way through the year, with grades for only their first few modules
+        unsigned gradeCount = random.below(10) == 0 ? random.below(moduleCount) : moduleCount;
+
+        //A student with no grades yet, or no phone number, has no tag for it at all
+        Tag tags[5] = {SID, NAME, ENROLLMENTS};
+        unsigned tagCount = 3;
+        if (gradeCount > 0) {
+            tags[tagCount++] = GRADES;
+        }
+        if (random.below(3) != 0) {
+            tags[tagCount++] = PHONE;
+        }
+        if (random.below(8) == 0) {
+            for (unsigned t = tagCount - 1; t > 0; t--) {
+                swap(tags[t], tags[random.below(t + 1)]);
+            }
+        }
+
+        out << "#RECORD\n";
+        for (unsigned t = 0; t < tagCount; t++) {
+            switch (tags[t]) {
+            case SID:
+                out << " #SID\n     " << FIRST_SID + static_cast<int>(n * stride % options.records) << "\n";
+                break;
+            case NAME:
+                out << " #NAME\n     " << FIRST_NAMES[random.below(countOf(FIRST_NAMES))];
+                if (random.below(5) == 0) {
+                    out << " " << FIRST_NAMES[random.below(countOf(FIRST_NAMES))];
+                }
+                out << " " << LAST_NAMES[random.below(countOf(LAST_NAMES))] << "\n";
+                break;
+            case ENROLLMENTS:
+                out << " #ENROLLMENTS\n    ";
+                for (unsigned m = 0; m < moduleCount; m++) {
+                    out << " " << SUBJECTS[modules[m] / 1000] << modules[m] % 1000;
+                }
+                out << "\n";
+                break;
+            case GRADES:
+                //Two draws added together, so grades bunch up in the middle as real ones do
+                out << " #GRADES\n    ";
+                for (unsigned m = 0; m < gradeCount; m++) {
+                    unsigned tenths = random.below(501) + random.below(501);
+                    out << " " << tenths / 10 << "." << tenths % 10;
+                }
+                out << "\n";
+                break;
+            case PHONE:
+                out << " #PHONE\n     44-" << 1000 + random.below(9000) << "-" << 100000 + random.below(900000) << "\n";
+                break;
+            }
+        }
+        out << "\n";
+    }
+}
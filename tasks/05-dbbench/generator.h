@@ -0,0 +1,33 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+/*
+ * Synthetic student databases for testing and benchmarking
+ *
+ * Records are written straight to the stream as they are made, so a database of tens of millions of
+ * records needs no more memory than one of a thousand. The same seed always gives the same file,
+ * on any platform (the random numbers come from a fixed generator, not <random>'s distributions).
+ *
+ * Like the example database, the tags of a record are not always in the usual order, about a third
+ * of the students have no phone number, and most take five or six modules.
+ */
+
+//Settings for generateDatabase
+struct GeneratorOptions {
+    size_t records = 1000;
+    uint64_t seed = 1;
+};
+
+//Functions
+
+//Student ID of record `n` of a generated database with `records` records
+//The IDs are unique, but not in order
+int generatedSid(size_t n, size_t records);
+
+//Write a database of `options.records` records to `op`
+void generateDatabase(std::ostream& op, const GeneratorOptions& options);
+
+#endif // GENERATOR_H
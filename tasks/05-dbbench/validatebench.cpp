@@ -0,0 +1,272 @@
+#include <iostream>
+#include <chrono>
+#include <cstdint>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "import.h"
+#include "numparse.h"
+#include "validate.h"
+using namespace std;
+
+/*
+ * Checks and times the validators of validate.h against the regular expressions they replace
+ *
+ *  validatebench [calls]
+ *
+ * First every validator is run over a table of inputs with known answers, and over random strings,
+ * and must agree with std::regex_match on every one. Then each is timed over <calls> inputs
+ * (default 200000) three ways: building the regex on every call (as the tools used to),
+ * with a regex built once, and with the validator. The results are written as CSV:
+ *
+ *  validator,method,calls,ns_per_call
+ *
+ * Students read from JSON Lines are also put through the checks of addrecord -import, which must
+ * turn away any whose fields could add lines of their own to the database.
+ *
+ * The exit code is EXIT_FAILURE if any answer differs.
+ */
+
+//A validator and the expression it replaces
+struct Validator {
+    const char* name;
+    const char* pattern;
+    bool (*check)(string_view);
+};
+
+static const Validator VALIDATORS[] = {
+    {"student_id", "^[0-9]+$", isValidStudentId},
+    {"name", "^[a-zA-Z]+ ([\\s][a-zA-Z]+)+$", isValidName},
+    {"storable_name", "^[^\\x00-\\x1f\\x7f]+$", isStorableName},
+    {"phone", "^[0-9-]+$", isValidPhoneNumber},
+    {"module_code", "^[a-zA-Z0-9]+$", isValidModuleCode},
+    {"grade", "^[0-9]+(\\.[0-9]+)?$", isValidGrade},
+};
+
+//Inputs with the answer every validator should give
+struct Case {
+    const char* validator;
+    const char* input;
+    bool valid;
+};
+
+static const Case CASES[] = {
+    {"student_id", "12345", true},
+    {"student_id", "0", true},
+    {"student_id", "007", true},
+    {"student_id", "", false},
+    {"student_id", "-1", false},
+    {"student_id", "+1", false},
+    {"student_id", "12 34", false},
+    {"student_id", "a2345", false},
+    {"student_id", "12345\n", false},
+
+    {"name", "Jo  King", true},
+    {"name", "Jo \tKing", true},
+    {"name", "Jo  Kingly Blunt", true},
+    {"name", "Jo  Kingly  Blunt", false},
+    {"name", "Jo \nKing", true},
+    {"name", "Jo King", false},
+    {"name", "Jo", false},
+    {"name", "Jo ", false},
+    {"name", "Jo  ", false},
+    {"name", "", false},
+    {"name", " Jo  King", false},
+    {"name", "Jo  King ", false},
+    {"name", "Jo   King", false},
+    {"name", "Jo\t King", false},
+    {"name", "Jo  K1ng", false},
+    {"name", "J\xC3\xB6  King", false},
+
+    {"storable_name", "Jo King", true},
+    {"storable_name", "Cher", true},
+    {"storable_name", "Siobhan O'Brien", true},
+    {"storable_name", "J\xC3\xB6 King", true},
+    {"storable_name", "", false},
+    {"storable_name", "Jo\nKing", false},
+    {"storable_name", "Jo\rKing", false},
+    {"storable_name", "Jo\tKing", false},
+    {"storable_name", "Jo King\x1b", false},
+    {"storable_name", "Jo\x7fKing", false},
+
+    {"phone", "44-1234-567890", true},
+    {"phone", "00-12-34567", true},
+    {"phone", "-", true},
+    {"phone", "0123", true},
+    {"phone", "", false},
+    {"phone", "00 12 34567", false},
+    {"phone", "+44-1234", false},
+    {"phone", "44_1234", false},
+
+    {"module_code", "COMP101", true},
+    {"module_code", "GIT101", true},
+    {"module_code", "x", true},
+    {"module_code", "9", true},
+    {"module_code", "", false},
+    {"module_code", "COMP-101", false},
+    {"module_code", "COMP 101", false},
+    {"module_code", "COMP101.", false},
+
+    {"grade", "78.4", true},
+    {"grade", "0", true},
+    {"grade", "100", true},
+    {"grade", "0.05", true},
+    {"grade", "", false},
+    {"grade", ".5", false},
+    {"grade", "5.", false},
+    {"grade", "5..5", false},
+    {"grade", "5.5.5", false},
+    {"grade", "-5", false},
+    {"grade", "1e3", false},
+    {"grade", "7x.5", false},
+    {"grade", " 5", false},
+};
+
+//Students as addrecord -import reads them from JSON Lines, and whether it should accept them
+struct ImportCase {
+    const char* line;
+    bool valid;
+};
+
+static const ImportCase IMPORT_CASES[] = {
+    {R"({"sid": 24680, "name": "Jo King", "phone": "44-1234-456123"})", true},
+    {R"({"sid": 24680, "name": "Jo King", "modulecodes": ["COMP101"], "grades": [40.5]})", true},
+    {R"({"sid": 24680, "name": "Jo King", "phone": "123\n#RECORD\n#SID\n777002\n#NAME\nEvil"})", false},
+    {R"({"sid": 24680, "name": "Jo King", "phone": "44 1234"})", false},
+    {R"({"sid": 24680, "name": "Jo King", "phone": "44\t1234"})", false},
+    {R"({"sid": 24680, "name": "Jo\n#RECORD"})", false},
+    {R"({"sid": 24680, "name": "Jo\rKing"})", false},
+    {R"({"sid": 24680, "name": "Jo\u0000King"})", false},
+    {R"({"sid": 24680, "name": "Jo\u001bKing"})", false},
+    {R"({"sid": 24680, "name": "Jo King", "modulecodes": ["COMP101\n#RECORD"]})", false},
+};
+
+static const Validator* validatorNamed(const string& name)
+{
+    for (const Validator& v : VALIDATORS) {
+        if (name == v.name) {
+            return &v;
+        }
+    }
+    return nullptr;
+}
+
+//Random strings, mostly made of the characters the validators care about
+static vector<string> randomInputs(size_t count, uint32_t seed)
+{
+    static const char ALPHABET[] = "aZk09 5-.\t\n_x";
+    vector<string> inputs;
+    for (size_t n = 0; n < count; n++) {
+        seed = seed * 1103515245u + 12345u;
+        size_t length = (seed >> 16) % 10;
+        string s;
+        for (size_t i = 0; i < length; i++) {
+            seed = seed * 1103515245u + 12345u;
+            s += ALPHABET[(seed >> 16) % (sizeof(ALPHABET) - 1)];
+        }
+        inputs.push_back(s);
+    }
+    return inputs;
+}
+
+//Realistic inputs for timing each validator
+static vector<string> timingInputs(const string& validator, size_t count)
+{
+    vector<string> samples;
+    if (validator == "student_id") samples = {"12345", "14351", "a2345", "15309"};
+    if (validator == "name") samples = {"Jo  Kingly Blunt", "Bee  Hyve", "Gee Rafferty", "Sam"};
+    if (validator == "storable_name") samples = {"Jo Kingly Blunt", "Bee Hyve", "Gee\nRafferty", "Siobhan O'Brien"};
+    if (validator == "phone") samples = {"44-1234-567890", "00-12-34567", "00 12 34567", "44-9876-543210"};
+    if (validator == "module_code") samples = {"COMP101", "ELEC133", "PROJ-101", "GIT101"};
+    if (validator == "grade") samples = {"78.4", "54.0", "7x.5", "100"};
+    vector<string> inputs;
+    for (size_t n = 0; n < count; n++) {
+        inputs.push_back(samples[n % samples.size()]);
+    }
+    return inputs;
+}
+
+template <typename Check>
+static double nsPerCall(const vector<string>& inputs, Check check)
+{
+    size_t accepted = 0;
+    auto start = chrono::steady_clock::now();
+    for (const string& s : inputs) {
+        accepted += check(s);
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    //Use the result, so the loop cannot be optimised away
+    if (accepted > inputs.size()) {
+        cerr << accepted << endl;
+    }
+    return seconds * 1e9 / inputs.size();
+}
+
+int main(int argc, char* argv[])
+{
+    int calls = 200000;
+    if (argc > 1 && (!parseInt(argv[1], calls).ok() || calls <= 0)) {
+        cerr << "Usage: validatebench [calls]" << endl;
+        return EXIT_FAILURE;
+    }
+
+    //The table of known answers
+    size_t failures = 0;
+    for (const Case& c : CASES) {
+        const Validator* v = validatorNamed(c.validator);
+        bool byRegex = regex_match(c.input, regex(v->pattern));
+        bool byValidator = v->check(c.input);
+        if (byRegex != c.valid || byValidator != c.valid) {
+            cerr << "FAIL " << c.validator << " \"" << c.input << "\": expected " << c.valid
+                 << ", regex " << byRegex << ", validator " << byValidator << endl;
+            failures++;
+        }
+    }
+
+    //Random strings, where the regex is the only judge
+    vector<string> random = randomInputs(20000, 1);
+    for (const Validator& v : VALIDATORS) {
+        regex re(v.pattern);
+        for (const string& s : random) {
+            if (regex_match(s, re) != v.check(s)) {
+                cerr << "FAIL " << v.name << " \"" << s << "\": regex and validator disagree" << endl;
+                failures++;
+            }
+        }
+    }
+
+    //Students read from JSON Lines
+    for (const ImportCase& c : IMPORT_CASES) {
+        istringstream ip(c.line);
+        string problem;
+        try {
+            vector<ImportRow> rows = readImportRows(ip, ImportFormat::JSONL);
+            ImportedStudent student;
+            problem = rows.size() == 1 ? checkImportRow(rows[0], student) : "not one row";
+        } catch (runtime_error& e) {
+            problem = e.what();
+        }
+        if (problem.empty() != c.valid) {
+            cerr << "FAIL import " << c.line << ": expected " << c.valid << ", got \"" << problem << "\"" << endl;
+            failures++;
+        }
+    }
+    cerr << "checked " << size(CASES) << " table cases, " << random.size() << " random strings per validator and "
+         << size(IMPORT_CASES) << " import lines, " << failures << " failures" << endl;
+
+    cout << "validator,method,calls,ns_per_call" << endl;
+    for (const Validator& v : VALIDATORS) {
+        vector<string> inputs = timingInputs(v.name, static_cast<size_t>(calls));
+        //Building a regex is so slow that a tenth of the calls is plenty
+        vector<string> fewer(inputs.begin(), inputs.begin() + inputs.size() / 10 + 1);
+        double perCall = nsPerCall(fewer, [&](const string& s) { return regex_match(s, regex(v.pattern)); });
+        regex re(v.pattern);
+        double built = nsPerCall(inputs, [&](const string& s) { return regex_match(s, re); });
+        double matcher = nsPerCall(inputs, [&](const string& s) { return v.check(s); });
+        cout << v.name << ",regex_per_call," << fewer.size() << "," << perCall << "\n";
+        cout << v.name << ",regex_built_once," << inputs.size() << "," << built << "\n";
+        cout << v.name << ",validator," << inputs.size() << "," << matcher << endl;
+    }
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
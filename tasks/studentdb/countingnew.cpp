@@ -0,0 +1,44 @@
+#include "runstats.h"
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+//Counting replacements for the global operator new and delete (see AllocationCounters in runstats.h).
+//Programs take this file through the countingnew target rather than from the library, since a program
+//can only replace operator new once. Every block carries its size in a small header, so the bytes still in use
+//can be followed; while counting is off, operator new only tests a flag before calling malloc
+static const size_t ALLOC_HEADER = alignof(max_align_t);
+
+static void* allocateCounted(size_t size)
+{
+    char* p = static_cast<char*>(malloc(size + ALLOC_HEADER));
+    if (p == nullptr) {
+        throw bad_alloc();
+    }
+    *reinterpret_cast<size_t*>(p) = size;
+    if (allocationCounters.counting.load(memory_order_relaxed)) {
+        allocationCounters.calls.fetch_add(1, memory_order_relaxed);
+        allocationCounters.liveBytes.fetch_add(static_cast<long long>(size), memory_order_relaxed);
+    }
+    return p + ALLOC_HEADER;
+}
+
+static void releaseCounted(void* ptr) noexcept
+{
+    if (ptr == nullptr) {
+        return;
+    }
+    char* p = static_cast<char*>(ptr) - ALLOC_HEADER;
+    if (allocationCounters.counting.load(memory_order_relaxed)) {
+        allocationCounters.liveBytes.fetch_sub(static_cast<long long>(*reinterpret_cast<size_t*>(p)), memory_order_relaxed);
+    }
+    free(p);
+}
+
+void* operator new(size_t size) { return allocateCounted(size); }
+void* operator new[](size_t size) { return allocateCounted(size); }
+void operator delete(void* ptr) noexcept { releaseCounted(ptr); }
+void operator delete[](void* ptr) noexcept { releaseCounted(ptr); }
+void operator delete(void* ptr, size_t) noexcept { releaseCounted(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { releaseCounted(ptr); }
@@ -0,0 +1,89 @@
+#include "dblock.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+string lockFileName(const string& dataBaseName)
+{
+    return dataBaseName + ".lock";
+}
+
+DatabaseLock::~DatabaseLock()
+{
+    unlock();
+}
+
+#ifdef _WIN32
+
+bool DatabaseLock::lock(const string& dataBaseName)
+{
+    unlock();
+    HANDLE file = CreateFileA(lockFileName(dataBaseName).c_str(), GENERIC_READ | GENERIC_WRITE,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    OVERLAPPED whole = {};
+    if (!LockFileEx(file, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &whole)) {
+        CloseHandle(file);
+        return false;
+    }
+    handle = file;
+    locked = true;
+    return true;
+}
+
+void DatabaseLock::unlock()
+{
+    if (handle != nullptr) {
+        OVERLAPPED whole = {};
+        UnlockFileEx(handle, 0, MAXDWORD, MAXDWORD, &whole);
+        CloseHandle(handle);
+        handle = nullptr;
+    }
+    locked = false;
+}
+
+#else
+
+bool DatabaseLock::lock(const string& dataBaseName)
+{
+    unlock();
+    int file = ::open(lockFileName(dataBaseName).c_str(), O_RDWR | O_CREAT, 0644);
+    if (file < 0) {
+        return false;
+    }
+    //A signal can interrupt the wait, in which case it is simply resumed
+    int result;
+    do {
+        result = flock(file, LOCK_EX);
+    } while (result != 0 && errno == EINTR);
+    if (result != 0) {
+        ::close(file);
+        return false;
+    }
+    fd = file;
+    locked = true;
+    return true;
+}
+
+void DatabaseLock::unlock()
+{
+    if (fd >= 0) {
+        flock(fd, LOCK_UN);
+        ::close(fd);
+        fd = -1;
+    }
+    locked = false;
+}
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef DBLOCK_H
+#define DBLOCK_H
+#include <string>
+
+/*
+ * Exclusive advisory lock on a database, taken by every tool before it changes the file
+ *
+ * The lock is held on a separate file, <database>.lock, so readers such as querydb are never held
+ * up, and the database itself can be replaced while it is locked. It is advisory: it only keeps out
+ * other programs that take it too. The operating system releases it if the process dies.
+ */
+class DatabaseLock {
+public:
+    DatabaseLock() = default;
+    ~DatabaseLock();
+
+    DatabaseLock(const DatabaseLock&) = delete;
+    DatabaseLock& operator=(const DatabaseLock&) = delete;
+
+    //Wait until no other process holds the lock on `dataBaseName`, then take it
+    //Returns false if the lock file cannot be opened or locked
+    bool lock(const std::string& dataBaseName);
+
+    //Release the lock (also done by the destructor)
+    void unlock();
+
+    bool isLocked() const { return locked; }
+
+private:
+    bool locked = false;
+#ifdef _WIN32
+    void* handle = nullptr;
+#else
+    int fd = -1;
+#endif
+};
+
+//Functions
+
+//Name of the lock file for the database `dataBaseName`
+std::string lockFileName(const std::string& dataBaseName);
+
+#endif // DBLOCK_H
@@ -0,0 +1,613 @@
+#include "dbparser.h"
+#include "numparse.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+using namespace std;
+
+//This is just an integer type, where START=0, NEXTTAG=1, RECORD=2 etc.....
+enum state_t {START, NEXTTAG, RECORD, SID, NAME, ENROLLMENTS, GRADES, PHONE};
+
+//Error found while parsing part of the file. The line number counts from the start of that part
+struct ChunkError {
+    size_t lineNumber;
+    string message;
+};
+
+[[noreturn]] static void parseError(size_t lineNumber, const string& message)
+{
+    throw ChunkError{lineNumber, message};
+}
+
+//Convert a ChunkError into an error that tells the user where in the file the problem is
+[[noreturn]] static void reportError(const ChunkError& e, size_t firstLine)
+{
+    throw runtime_error("Line " + to_string(firstLine + e.lineNumber) + ": " + e.message);
+}
+
+//Map a tag onto the state that reads its value (string_view version of the nextState look up table)
+static bool tagState(string_view tag, state_t& state)
+{
+    if (tag == "#RECORD") {
+        state = RECORD;
+    } else if (tag == "#SID") {
+        state = SID;
+    } else if (tag == "#NAME") {
+        state = NAME;
+    } else if (tag == "#ENROLLMENTS") {
+        state = ENROLLMENTS;
+    } else if (tag == "#GRADES") {
+        state = GRADES;
+    } else if (tag == "#PHONE") {
+        state = PHONE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+//Return the next space separated token in `s` (starting at `pos`), or an empty view if there are none left
+static string_view nextToken(string_view s, size_t& pos)
+{
+    while (pos < s.size() && (s[pos] == ' ' || s[pos] == '\t')) {
+        pos++;
+    }
+    size_t start = pos;
+    while (pos < s.size() && s[pos] != ' ' && s[pos] != '\t') {
+        pos++;
+    }
+    return s.substr(start, pos - start);
+}
+
+//Remove trailing spaces and tabs
+static string_view trimRight(string_view s)
+{
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) {
+        s.remove_suffix(1);
+    }
+    return s;
+}
+
+//Record being read by parseChunk. The name and phone point into the text, and the lists are reused
+//from one record to the next, so nothing is allocated per record
+struct PendingRecord {
+    int SID = 0;
+    string_view name;
+    vector<ModuleId> enrollments;
+    vector<float> grades;
+    string_view phone;
+
+    void addTo(RecordStore& db) const
+    {
+        RecordView v;
+        v.SID = SID;
+        v.name = name;
+        v.enrollments = {enrollments.data(), enrollments.size()};
+        v.grades = {grades.data(), grades.size()};
+        v.phone = phone;
+        db.add(v);
+    }
+
+    void reset()
+    {
+        SID = 0;
+        name = string_view();
+        enrollments.clear();
+        grades.clear();
+        phone = string_view();
+    }
+};
+
+//Parse a run of whole records. Unless this is the last part of the file, the final record is always kept
+//(the sequential parser would keep it when it reaches the next #RECORD)
+static void parseChunk(string_view text, RecordStore& db, bool lastChunk)
+{
+    const char* p = text.data();
+    const char* end = p + text.size();
+    size_t lineNumber = 0;
+
+    int recordNumber = -1;
+    PendingRecord nextRecord;
+    state_t state = START;
+
+    //Module codes already interned by this call, keyed on their text in `text`, so the shared
+    //dictionary (and its lock) is only visited once per distinct code
+    unordered_map<string_view, ModuleId> localIds;
+
+    while (p < end)
+    {
+        //Find the end of this line without copying it
+        const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+        if (eol == nullptr) {
+            eol = end;
+        }
+        string_view nextStr(p, eol - p);
+        p = eol + 1;
+        lineNumber++;
+
+        //Allow for files written on Windows
+        if (!nextStr.empty() && nextStr.back() == '\r') {
+            nextStr.remove_suffix(1);
+        }
+
+        //Remove leading spaces
+        size_t firstChar = nextStr.find_first_not_of(' ');
+        if (firstChar == string_view::npos) {
+            //Skip blank lines
+            continue;
+        }
+        nextStr.remove_prefix(firstChar);
+
+        //Same state machine as parseDatabaseLegacy
+        switch (state)
+        {
+        case START:
+            if (nextStr != "#RECORD") {
+                parseError(lineNumber, "Expected #RECORD as first tag");
+            }
+            state = RECORD;
+            recordNumber = 0;
+            break;
+        case RECORD:
+            //Except for the first occasion, save the record we have just finished reading
+            if (recordNumber > 0) {
+                nextRecord.addTo(db);
+                nextRecord.reset();
+            }
+            recordNumber++;
+            //Fall through - #RECORD is always followed by a tag
+            [[fallthrough]];
+        case NEXTTAG:
+            if (!tagState(nextStr, state)) {
+                parseError(lineNumber, "Unknown tag " + string(nextStr));
+            }
+            break;
+        case SID:
+        {
+            string_view digits = trimRight(nextStr);
+            NumberResult result = parseInt(digits, nextRecord.SID);
+            if (!result.ok()) {
+                parseError(lineNumber, numberErrorMessage(result, digits, "student ID"));
+            }
+            state = NEXTTAG;
+            break;
+        }
+        case NAME:
+            nextRecord.name = nextStr;
+            state = NEXTTAG;
+            break;
+        case ENROLLMENTS:
+        {
+            //A list of module codes separated by spaces
+            size_t pos = 0;
+            for (string_view code = nextToken(nextStr, pos); !code.empty(); code = nextToken(nextStr, pos)) {
+                auto it = localIds.find(code);
+                if (it == localIds.end()) {
+                    it = localIds.emplace(code, moduleId(code)).first;
+                }
+                nextRecord.enrollments.push_back(it->second);
+            }
+            state = NEXTTAG;
+            break;
+        }
+        case GRADES:
+        {
+            //A list of grades separated by spaces
+            size_t pos = 0;
+            for (string_view grade = nextToken(nextStr, pos); !grade.empty(); grade = nextToken(nextStr, pos)) {
+                float g;
+                NumberResult result = parseFloat(grade, g);
+                if (!result.ok()) {
+                    parseError(lineNumber, numberErrorMessage(result, grade, "grade"));
+                }
+                nextRecord.grades.push_back(g);
+            }
+            state = NEXTTAG;
+            break;
+        }
+        case PHONE:
+            nextRecord.phone = nextStr;
+            state = NEXTTAG;
+            break;
+        } //End Switch
+    }
+
+    //The loop above may exit before pushing the last record into db
+    if (recordNumber > 0 && (!lastChunk || nextRecord.SID > 0)) {
+        nextRecord.addTo(db);
+    }
+}
+
+void parseDatabase(string_view text, RecordStore& db, size_t firstLine)
+{
+    try {
+        parseChunk(text, db, true);
+    } catch (const ChunkError& e) {
+        reportError(e, firstLine);
+    }
+}
+
+//Return true if the line starting at `p` is a #RECORD tag (leading spaces allowed)
+static bool isRecordTag(const char* p, const char* end)
+{
+    while (p < end && *p == ' ') {
+        p++;
+    }
+    string_view tag = "#RECORD";
+    if (size_t(end - p) < tag.size() || string_view(p, tag.size()) != tag) {
+        return false;
+    }
+    p += tag.size();
+    return p == end || *p == '\n' || (*p == '\r' && (p + 1 == end || p[1] == '\n'));
+}
+
+//Move `pos` forward to the start of the next line that holds a #RECORD tag (or the end of the text)
+static size_t nextRecordBoundary(string_view text, size_t pos)
+{
+    const char* begin = text.data();
+    const char* end = begin + text.size();
+    const char* p = begin + pos;
+
+    //Never split in the middle of a line
+    if (pos > 0 && p[-1] != '\n') {
+        p = static_cast<const char*>(memchr(p, '\n', end - p));
+        p = p ? p + 1 : end;
+    }
+    while (p < end && !isRecordTag(p, end)) {
+        p = static_cast<const char*>(memchr(p, '\n', end - p));
+        p = p ? p + 1 : end;
+    }
+    return static_cast<size_t>(p - begin);
+}
+
+size_t lastRecordTag(string_view text)
+{
+    //Walk back line by line from the end
+    size_t lineStart = text.size();
+    while (lineStart > 0) {
+        size_t newline = text.rfind('\n', lineStart - 1);
+        size_t start = newline == string_view::npos ? 0 : newline + 1;
+        if (start < lineStart && isRecordTag(text.data() + start, text.data() + text.size())) {
+            return start;
+        }
+        if (newline == string_view::npos) {
+            break;
+        }
+        lineStart = newline;
+    }
+    return string_view::npos;
+}
+
+void parseDatabaseParallel(string_view text, RecordStore& db, unsigned threads)
+{
+    if (threads == 0) {
+        threads = max(1u, thread::hardware_concurrency());
+    }
+    //Small files are not worth starting threads for
+    if (threads == 1 || text.size() < 1024 * 1024) {
+        parseDatabase(text, db);
+        return;
+    }
+
+    //Cut the file into more pieces than there are threads, so a slow piece does not hold the others up
+    size_t pieces = size_t(threads) * 4;
+    vector<size_t> bounds(1, 0);
+    for (size_t i = 1; i < pieces; i++) {
+        size_t b = nextRecordBoundary(text, max(bounds.back(), text.size() * i / pieces));
+        if (b > bounds.back() && b < text.size()) {
+            bounds.push_back(b);
+        }
+    }
+    bounds.push_back(text.size());
+    size_t chunks = bounds.size() - 1;
+
+    //Each worker takes the next unparsed piece until there are none left
+    vector<RecordStore> results(chunks);
+    vector<ChunkError> errors(chunks);
+    vector<char> failed(chunks, 0);
+    atomic<size_t> nextChunk(0);
+    auto worker = [&]() {
+        for (size_t c = nextChunk++; c < chunks; c = nextChunk++) {
+            try {
+                parseChunk(text.substr(bounds[c], bounds[c + 1] - bounds[c]), results[c], c == chunks - 1);
+            } catch (const ChunkError& e) {
+                errors[c] = e;
+                failed[c] = 1;
+            }
+        }
+    };
+    vector<thread> pool;
+    for (unsigned t = 1; t < min<size_t>(threads, chunks); t++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (thread& t : pool) {
+        t.join();
+    }
+
+    //Report the first error in the file, with its line number counted from the start of the file
+    for (size_t c = 0; c < chunks; c++) {
+        if (failed[c]) {
+            const char* first = text.data();
+            reportError(errors[c], size_t(count(first, first + bounds[c], '\n')));
+        }
+    }
+
+    //Join the pieces back together in file order
+    size_t total = 0;
+    for (const RecordStore& part : results) {
+        total += part.size();
+    }
+    db.reserve(total);
+    for (RecordStore& part : results) {
+        db.append(part);
+        part.clear();
+    }
+}
+
+bool parseRecord(string_view text, Record& r)
+{
+    RecordStore found;
+    try {
+        parseChunk(text, found, false);
+    } catch (const ChunkError& e) {
+        throw runtime_error("Line " + to_string(e.lineNumber) + " of record: " + e.message);
+    }
+    if (found.empty()) {
+        return false;
+    }
+    r = found.record(0);
+    return true;
+}
+
+bool scanRecords(MappedFile& file, const RecordVisitor& visit)
+{
+    string_view text = file.view();
+    const char* begin = text.data();
+    const char* p = begin;
+    const char* end = p + text.size();
+    size_t lineNumber = 0;
+
+    //Only the states needed to tell tags from values - everything but #SID is skipped unparsed
+    enum scan_t {SCAN_START, SCAN_TAG, SCAN_SID, SCAN_VALUE};
+    scan_t state = SCAN_START;
+    const char* recordStart = nullptr;
+    int recordSID = 0;
+    bool haveRecord = false;
+    const size_t releaseStep = 8 * 1024 * 1024;
+    size_t released = 0;
+
+    while (p < end)
+    {
+        const char* lineStart = p;
+        const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+        if (eol == nullptr) {
+            eol = end;
+        }
+        string_view nextStr(p, eol - p);
+        p = eol + 1;
+        lineNumber++;
+
+        //Let the OS drop pages we have finished with
+        if (size_t(lineStart - begin) - released >= releaseStep) {
+            released = size_t(lineStart - begin);
+            file.release(released);
+        }
+
+        if (!nextStr.empty() && nextStr.back() == '\r') {
+            nextStr.remove_suffix(1);
+        }
+        size_t firstChar = nextStr.find_first_not_of(' ');
+        if (firstChar == string_view::npos) {
+            continue;
+        }
+        nextStr.remove_prefix(firstChar);
+
+        state_t tag;
+        switch (state)
+        {
+        case SCAN_START:
+            if (nextStr != "#RECORD") {
+                reportError(ChunkError{lineNumber, "Expected #RECORD as first tag"}, 0);
+            }
+            recordStart = lineStart;
+            state = SCAN_TAG;
+            break;
+        case SCAN_TAG:
+            if (!tagState(nextStr, tag)) {
+                reportError(ChunkError{lineNumber, "Unknown tag " + string(nextStr)}, 0);
+            }
+            if (tag == RECORD) {
+                //The previous record is complete
+                if (haveRecord && !visit(recordSID, size_t(recordStart - begin), size_t(lineStart - recordStart))) {
+                    return false;
+                }
+                recordStart = lineStart;
+                recordSID = 0;
+                haveRecord = false;
+            } else {
+                haveRecord = true;
+                state = tag == SID ? SCAN_SID : SCAN_VALUE;
+            }
+            break;
+        case SCAN_SID:
+        {
+            string_view digits = trimRight(nextStr);
+            NumberResult result = parseInt(digits, recordSID);
+            if (!result.ok()) {
+                reportError(ChunkError{lineNumber, numberErrorMessage(result, digits, "student ID")}, 0);
+            }
+            state = SCAN_TAG;
+            break;
+        }
+        case SCAN_VALUE:
+            state = SCAN_TAG;
+            break;
+        }
+    }
+
+    //As in parseDatabase, the last record only counts if it has a student ID
+    if (haveRecord && recordSID > 0) {
+        return visit(recordSID, size_t(recordStart - begin), size_t(end - recordStart));
+    }
+    return true;
+}
+
+bool findRecord(MappedFile& file, int sid, Record& r, size_t* scanned)
+{
+    string_view text = file.view();
+    bool found = false;
+    size_t scanEnd = text.size();
+
+    scanRecords(file, [&](int recordSID, size_t offset, size_t length) {
+        if (recordSID != sid) {
+            return true;
+        }
+        //Parse this record in full, reporting errors with their line number in the file
+        RecordStore records;
+        try {
+            parseChunk(text.substr(offset, length), records, offset + length == text.size());
+        } catch (const ChunkError& e) {
+            reportError(e, size_t(count(text.begin(), text.begin() + offset, '\n')));
+        }
+        if (records.empty()) {
+            return true;
+        }
+        r = records.record(0);
+        found = true;
+        scanEnd = offset + length;
+        return false;
+    });
+
+    if (scanned) {
+        *scanned = scanEnd;
+    }
+    return found;
+}
+
+void parseDatabaseLegacy(istream& ip, vector<Record>& db)
+{
+    //Locals used for navigating the database file
+    string nextLine;
+    int recordNumber = -1;
+    Record nextRecord{};
+    stringstream moduleCodes;
+    stringstream moduleGrades;
+    string moduleCode = "";
+    string moduleGrade = "";
+
+    //Locals used for the "state machine"
+    state_t state = START;
+
+    //"Look up table" - maps a string to an integer. e.g. nextState["#SID"] returns 1
+    map<string,state_t> nextState = {
+        {"#RECORD", RECORD},
+        {"#SID", SID},
+        {"#NAME", NAME},
+        {"#ENROLLMENTS", ENROLLMENTS},
+        {"#GRADES", GRADES},
+        {"#PHONE", PHONE}
+    };
+
+    //Read the next line (loop exits on end of file)
+    while (getline(ip, nextLine))
+    {
+        // Remove leading spaces
+        // Replace "start of line (^) followed by any number of trailing spaces (' +')" with with nothing ""
+        string nextStr = regex_replace(nextLine, regex("^ +"), "");
+
+        //Skip blank lines
+        if (nextStr.empty()) continue;
+
+        //Enter "state machine" - study this carefully - it's a really useful "pattern"
+        switch (state)
+        {
+        case START:
+            //We begin here - the first non-blank line MUST start with "#RECORD"
+            if (nextStr != "#RECORD") {
+                //The first list MUST simply read #RECORD
+                throw runtime_error("Expected #RECORD as first tag");
+            }
+            //Next time around the loop, use the RECORD state
+            state = RECORD;
+            recordNumber = 0;
+            break;
+        case RECORD: //Everytime a #RECORD is found, we enter this state on the next line
+            //Except for the first occasion, save the record we have just finished reading
+            if (recordNumber > 0) {
+                //For each new #RECORD tag, store the previous
+                db.push_back(nextRecord);
+                //Reset the nextRecord to defaults
+                nextRecord = {};
+            }
+            //Increment the record number
+            recordNumber++;
+            //Fall through into SEEK (note the break is missing) - #RECORD is always followed by a tag
+            [[fallthrough]];
+        case NEXTTAG:
+            //nextString should contain a tag at this point - will throw an exception if not
+            state = nextState[nextStr];
+            break;
+        case SID:
+            //nextStr should contain a string representation of an integer. If not, an exception will be thrown
+            nextRecord.SID = stoi(nextStr);
+            //Now look for the next tag
+            state = NEXTTAG;
+            break;
+        case NAME:
+            //nextStr should contain a name
+            nextRecord.name = nextStr;
+            state = NEXTTAG;
+            break;
+        case ENROLLMENTS:
+            //nextString should be a list of module codes separated by spaces
+            moduleCodes = stringstream(nextStr);
+            //Extract each separate module code
+            while (moduleCodes.eof() == false) {
+                moduleCodes >> moduleCode;
+                //If the prevous line did not succeed, we've probably read a space on the end
+                if (moduleCodes.fail()) {
+                    break;
+                }
+                //Add the module string to the `enrollments` vector
+                nextRecord.enrollments.push_back(moduleId(moduleCode));
+            }
+            state = NEXTTAG;
+            break;
+        case GRADES:
+            //nextString should contain a list of grades, separated by spaces
+            moduleGrades = stringstream(nextStr);
+            //Extract each separate module grade as a float
+            while (moduleGrades.eof() == false) {
+                moduleGrades >> moduleGrade;
+                if (moduleGrades.fail()) {
+                    break;
+                }
+                //Convert to float, and save in the grades vector
+                nextRecord.grades.push_back(stof(moduleGrade)); //This can throw an exception
+            }
+            state = NEXTTAG;
+            break;
+
+        case PHONE:
+            //Next String should be a phone number (no spaces)
+            nextRecord.phone = nextStr;
+            state = NEXTTAG;
+            break;
+        } //End Switch
+
+    } //End while
+
+    //The loop above may exit before pushing the last record into db
+    if (nextRecord.SID > 0) {
+        db.push_back(nextRecord);
+    }
+}
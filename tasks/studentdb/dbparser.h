@@ -0,0 +1,49 @@
+#ifndef DBPARSER_H
+#define DBPARSER_H
+#include <functional>
+#include <istream>
+#include <string_view>
+#include <vector>
+#include "mappedfile.h"
+#include "recordstore.h"
+#include "studentrecord.h"
+
+//Functions
+
+//Parse the whole database held in `text` and append every record to `db`
+//Works directly on the text (e.g. a MappedFile view) in a single pass, without copying lines
+//Throws std::runtime_error (with the line number) if the data is malformed
+//`firstLine` is the number of lines in the file before `text`, so errors in part of a file give the right line
+void parseDatabase(std::string_view text, RecordStore& db, size_t firstLine = 0);
+
+//Same as parseDatabase, but splits the text at #RECORD tags and parses the pieces on `threads` threads
+//(0 means one per processor). The records are appended to `db` in file order
+void parseDatabaseParallel(std::string_view text, RecordStore& db, unsigned threads);
+
+//Offset of the last line in `text` that holds a #RECORD tag, or std::string_view::npos if there is none
+size_t lastRecordTag(std::string_view text);
+
+//Parse the text of one record (from its #RECORD tag up to the next one) into `r`
+//Returns false if it holds no record. Throws std::runtime_error if the data is malformed
+bool parseRecord(std::string_view text, Record& r);
+
+//Called by scanRecords for every record: its student ID and the byte offset and length of its text
+//Return false to stop the scan
+using RecordVisitor = std::function<bool(int sid, size_t offset, size_t length)>;
+
+//Walk the database in `file` record by record, parsing only the #SID values, and call `visit` for each record
+//(the same records parseDatabase would produce). Pages that have been scanned are released as it goes
+//Returns false if `visit` stopped the scan. Throws std::runtime_error if a tag or student ID is malformed
+bool scanRecords(MappedFile& file, const RecordVisitor& visit);
+
+//Scan the database in `file` for the first record with student ID `sid` and copy it into `r`
+//Stops at the first match, and only the #SID values of other records are parsed (see scanRecords)
+//If `scanned` is given, it is set to the number of bytes read. Returns false if there is no such record
+//Throws std::runtime_error (with the line number) if the data is malformed
+bool findRecord(MappedFile& file, int sid, Record& r, size_t* scanned = nullptr);
+
+//The original line-by-line state machine (getline + regex), kept for comparison with parseDatabase
+//Throws an exception if the data is malformed
+void parseDatabaseLegacy(std::istream& ip, std::vector<Record>& db);
+
+#endif // DBPARSER_H
@@ -0,0 +1,267 @@
+#include "delta.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include "numparse.h"
+#include "rewrite.h"
+#include "snapshot.h"
+using namespace std;
+
+//Names of the fields in the log
+static const char* const FIELD_NAMES[] = {"NAME", "PHONE", "ENROL", "GRADE"};
+
+string deltaFileName(const string& dataBaseName)
+{
+    return dataBaseName + ".delta";
+}
+
+bool hasDeltas(const string& dataBaseName)
+{
+    error_code ec;
+    uintmax_t size = filesystem::file_size(deltaFileName(dataBaseName), ec);
+    return !ec && size > 0;
+}
+
+//Split the next space-separated word off the front of `text`
+static string_view nextWord(string_view& text)
+{
+    size_t end = min(text.find(' '), text.size());
+    string_view word = text.substr(0, end);
+    text.remove_prefix(min(end + 1, text.size()));
+    return word;
+}
+
+//Read one line of the log
+static Delta parseDelta(string_view line, size_t lineNumber)
+{
+    auto error = [&](const string& what) {
+        return runtime_error("Line " + to_string(lineNumber) + " of delta log: " + what);
+    };
+    Delta d;
+    if (nextWord(line) != "#SET") {
+        throw error("expected #SET");
+    }
+    string_view sid = nextWord(line);
+    NumberResult result = parseInt(sid, d.sid);
+    if (!result.ok()) {
+        throw error(numberErrorMessage(result, sid, "student ID"));
+    }
+    string_view field = nextWord(line);
+    auto named = find(begin(FIELD_NAMES), end(FIELD_NAMES), field);
+    if (named == end(FIELD_NAMES)) {
+        throw error("unknown field " + string(field));
+    }
+    d.field = static_cast<DeltaField>(named - begin(FIELD_NAMES));
+    switch (d.field) {
+    case DeltaField::NAME:
+    case DeltaField::PHONE:
+        //The rest of the line, spaces and all
+        d.text = string(line);
+        break;
+    case DeltaField::ENROL:
+        d.module = moduleId(nextWord(line));
+        break;
+    case DeltaField::GRADE:
+    {
+        d.module = moduleId(nextWord(line));
+        string_view grade = nextWord(line);
+        result = parseFloat(grade, d.grade);
+        if (!result.ok()) {
+            throw error(numberErrorMessage(result, grade, "grade"));
+        }
+        break;
+    }
+    }
+    return d;
+}
+
+bool readDeltas(const string& dataBaseName, vector<Delta>& deltas)
+{
+    ifstream ip(deltaFileName(dataBaseName), ios::binary);
+    if (!ip.is_open()) {
+        return false;
+    }
+    string line;
+    size_t lineNumber = 0;
+    while (getline(ip, line)) {
+        lineNumber++;
+        //A line without its newline was cut short by a writer that stopped part way, so it never happened
+        if (ip.eof()) {
+            break;
+        }
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.find_first_not_of(' ') == string::npos) {
+            continue;
+        }
+        deltas.push_back(parseDelta(line, lineNumber));
+    }
+    return true;
+}
+
+bool appendDeltas(const string& dataBaseName, const vector<Delta>& deltas)
+{
+    ostringstream text;
+    for (const Delta& d : deltas) {
+        text << "#SET " << d.sid << ' ' << FIELD_NAMES[static_cast<int>(d.field)];
+        switch (d.field) {
+        case DeltaField::NAME:
+        case DeltaField::PHONE:
+            text << ' ' << d.text;
+            break;
+        case DeltaField::ENROL:
+            text << ' ' << moduleName(d.module);
+            break;
+        case DeltaField::GRADE:
+            text << ' ' << moduleName(d.module) << ' ' << d.grade;
+            break;
+        }
+        text << '\n';
+    }
+    ofstream op(deltaFileName(dataBaseName), ios::app | ios::binary);
+    if (!op.is_open()) {
+        return false;
+    }
+    op << text.str();
+    op.close();
+    return !op.fail();
+}
+
+bool applyDelta(Record& r, const Delta& delta)
+{
+    switch (delta.field) {
+    case DeltaField::NAME:
+        r.name = delta.text;
+        return true;
+    case DeltaField::PHONE:
+        r.phone = delta.text;
+        return true;
+    case DeltaField::ENROL:
+    case DeltaField::GRADE:
+        break;
+    }
+    size_t position = find(r.enrollments.begin(), r.enrollments.end(), delta.module) - r.enrollments.begin();
+    if (delta.field == DeltaField::GRADE && position > r.grades.size()) {
+        return false;
+    }
+    if (position == r.enrollments.size()) {
+        r.enrollments.push_back(delta.module);
+    }
+    if (delta.field == DeltaField::GRADE) {
+        if (position < r.grades.size()) {
+            r.grades[position] = delta.grade;
+        }
+        else {
+            r.grades.push_back(delta.grade);
+        }
+    }
+    return true;
+}
+
+size_t mergeDeltas(const string& dataBaseName, RecordStore& db)
+{
+    vector<Delta> deltas;
+    if (!readDeltas(dataBaseName, deltas)) {
+        return 0;
+    }
+    applyDeltas(deltas, db);
+    return deltas.size();
+}
+
+void applyDeltas(const vector<Delta>& deltas, RecordStore& db)
+{
+    if (deltas.empty()) {
+        return;
+    }
+
+    //Find the records that change in one pass, then change each once
+    unordered_map<int, long long> changed;
+    for (const Delta& d : deltas) {
+        changed.emplace(d.sid, -1);
+    }
+    const vector<int>& sids = db.sidColumn();
+    for (size_t n = 0; n < sids.size(); n++) {
+        auto it = changed.find(sids[n]);
+        if (it != changed.end() && it->second < 0) {
+            it->second = static_cast<long long>(n);
+        }
+    }
+    unordered_map<int, Record> records;
+    for (const Delta& d : deltas) {
+        long long n = changed[d.sid];
+        if (n < 0) {
+            continue;
+        }
+        auto it = records.find(d.sid);
+        if (it == records.end()) {
+            it = records.emplace(d.sid, db.record(static_cast<size_t>(n))).first;
+        }
+        applyDelta(it->second, d);
+    }
+    for (const auto& [sid, r] : records) {
+        size_t n = static_cast<size_t>(changed[sid]);
+        db.setName(n, r.name);
+        db.setPhone(n, r.phone);
+        db.setLists(n, r.enrollments, r.grades);
+    }
+}
+
+size_t mergeDeltas(const string& dataBaseName, Record& r)
+{
+    vector<Delta> deltas;
+    if (!readDeltas(dataBaseName, deltas)) {
+        return 0;
+    }
+    for (const Delta& d : deltas) {
+        if (d.sid == r.SID) {
+            applyDelta(r, d);
+        }
+    }
+    return deltas.size();
+}
+
+bool compactionDue(const string& dataBaseName)
+{
+    SourceStamp log, db;
+    if (!sourceStamp(deltaFileName(dataBaseName), log) || log.size == 0) {
+        return false;
+    }
+    if (!sourceStamp(dataBaseName, db) || log.size > COMPACT_FRACTION * db.size) {
+        return true;
+    }
+    ifstream ip(deltaFileName(dataBaseName), ios::binary);
+    size_t lines = static_cast<size_t>(count(istreambuf_iterator<char>(ip), istreambuf_iterator<char>(), '\n'));
+    return lines > COMPACT_DELTAS;
+}
+
+size_t compactDatabase(const string& dataBaseName)
+{
+    vector<Delta> deltas;
+    if (!readDeltas(dataBaseName, deltas)) {
+        return 0;
+    }
+
+    //Only the records with changes are written afresh, everything else is copied across as it is
+    unordered_map<int, vector<const Delta*>> bySid;
+    unordered_set<int> sids;
+    for (const Delta& d : deltas) {
+        bySid[d.sid].push_back(&d);
+        sids.insert(d.sid);
+    }
+    rewriteDatabase(dataBaseName, sids, [&](Record& r) {
+        for (const Delta* d : bySid[r.SID]) {
+            applyDelta(r, *d);
+        }
+    });
+
+    //The changes are in the database now. Stopping before this line only means they are applied twice
+    error_code ec;
+    filesystem::remove(deltaFileName(dataBaseName), ec);
+    return deltas.size();
+}
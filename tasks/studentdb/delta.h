@@ -0,0 +1,87 @@
+#ifndef DELTA_H
+#define DELTA_H
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "recordstore.h"
+#include "studentrecord.h"
+
+/*
+ * Log of changes to existing records, kept alongside a text database as <database>.delta
+ *
+ * Instead of changing a record where it lies, updaterecord can append a line per change to the log,
+ * which costs the same however large the database is:
+ *
+ *  #SET 12345 NAME Jo  Kingly
+ *  #SET 12345 PHONE 00-12-34567
+ *  #SET 12345 ENROL COMP1001
+ *  #SET 12345 GRADE COMP1001 78.4
+ *
+ * Readers apply the changes, in order, on top of the records of the database as they load them
+ * (loadDatabase does so for every tool). Every change sets a value rather than adjusting one, so
+ * applying a change to a record that already has it makes no difference - which is what makes
+ * compaction safe: compactDatabase writes the changed records back into the database and only then
+ * removes the log, so stopping in between leaves changes that are simply applied a second time.
+ * How much work the log adds to each load is bounded by running compaction once compactionDue says so.
+ */
+
+//Which part of a record a change sets
+enum class DeltaField {
+    NAME,
+    PHONE,
+    ENROL,      //Enrol on `module` (if not already)
+    GRADE       //Enrol on `module` and set its grade
+};
+
+//One change to the record of student `sid`
+struct Delta {
+    int sid = 0;
+    DeltaField field = DeltaField::NAME;
+    std::string text;           //NAME, PHONE
+    ModuleId module = 0;        //ENROL, GRADE
+    float grade = 0;            //GRADE
+};
+
+//When compactionDue says the log should be folded into the database
+const size_t COMPACT_DELTAS = 10000;            //Changes in the log
+const double COMPACT_FRACTION = 0.1;            //Size of the log as a fraction of the database
+
+//Functions
+
+//Name of the delta log for the database `dataBaseName`
+std::string deltaFileName(const std::string& dataBaseName);
+
+//Does `dataBaseName` have changes waiting in its delta log?
+bool hasDeltas(const std::string& dataBaseName);
+
+//Read every change in the delta log of `dataBaseName` into `deltas`, in the order they were made
+//Returns false if there is no log. Throws std::runtime_error (with the line number) if it is malformed
+bool readDeltas(const std::string& dataBaseName, std::vector<Delta>& deltas);
+
+//Append `deltas` to the log of `dataBaseName` in one write. The caller must hold the database lock (see dblock.h)
+//Returns false if the log cannot be written
+bool appendDeltas(const std::string& dataBaseName, const std::vector<Delta>& deltas);
+
+//Apply one change to `r`. Grades are paired with enrollments by position, so a new module goes on the
+//end of the list, and its grade can only be set if every module ahead of it has a grade
+//Returns false (leaving `r` unchanged) if the grade cannot be placed
+bool applyDelta(Record& r, const Delta& delta);
+
+//Apply every change in the log of `dataBaseName` to the records of `db` (or just to `r`)
+//Returns the number of changes read. Throws std::runtime_error if the log is malformed
+size_t mergeDeltas(const std::string& dataBaseName, RecordStore& db);
+size_t mergeDeltas(const std::string& dataBaseName, Record& r);
+
+//Apply `deltas` (read with readDeltas) to the records of `db`, e.g. to one part of a database loaded in pieces
+void applyDeltas(const std::vector<Delta>& deltas, RecordStore& db);
+
+//Is the delta log of `dataBaseName` big enough to be worth compacting (see COMPACT_DELTAS)?
+bool compactionDue(const std::string& dataBaseName);
+
+//Fold the delta log of `dataBaseName` into the database: rewrite it with the changes applied to the records
+//they are for (see rewrite.h), then remove the log. The index, if there is one, is rebuilt. The caller must
+//hold the database lock. Returns the number of changes folded in
+//Throws std::runtime_error if the database or log cannot be read or the new database cannot be written
+size_t compactDatabase(const std::string& dataBaseName);
+
+#endif // DELTA_H
@@ -0,0 +1,392 @@
+#include "journal.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+#include "dblock.h"
+#include "dbparser.h"
+#include "mappedfile.h"
+#include "runstats.h"
+#include "sidindex.h"
+#include "snapshot.h"
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <process.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+//Names of the outcomes, also used as the extensions of the answer files
+static const char* const OUTCOME_NAMES[] = {"added", "duplicate", "invalid", "failed"};
+
+static const char* outcomeName(AppendOutcome outcome)
+{
+    return OUTCOME_NAMES[static_cast<int>(outcome)];
+}
+
+string journalDirName(const string& dataBaseName)
+{
+    return dataBaseName + ".journal";
+}
+
+//Write `text` to `fileName` (added to the end, or replacing what was there) and sync it to disk
+//A single write is used, so the text lands in one piece as far as other writers are concerned
+static bool writeSynced(const string& fileName, string_view text, bool append)
+{
+#ifdef _WIN32
+    int fd = _open(fileName.c_str(), _O_WRONLY | _O_CREAT | _O_BINARY | (append ? _O_APPEND : _O_TRUNC), 0644);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = true;
+    while (ok && !text.empty()) {
+        int written = _write(fd, text.data(), static_cast<unsigned>(min<size_t>(text.size(), 1u << 30)));
+        ok = written > 0;
+        if (ok) {
+            text.remove_prefix(static_cast<size_t>(written));
+        }
+    }
+    ok = ok && _commit(fd) == 0;
+    return _close(fd) == 0 && ok;
+#else
+    int fd = ::open(fileName.c_str(), O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC), 0644);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = true;
+    while (ok && !text.empty()) {
+        ssize_t written = ::write(fd, text.data(), text.size());
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        ok = written > 0;
+        if (ok) {
+            text.remove_prefix(static_cast<size_t>(written));
+        }
+    }
+    ok = ok && fsync(fd) == 0;
+    return ::close(fd) == 0 && ok;
+#endif
+}
+
+//Make renames and new files in `dirName` durable (directories cannot be synced on Windows, nor need to be)
+static void syncDir(const string& dirName)
+{
+#ifndef _WIN32
+    int fd = ::open(dirName.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        ::close(fd);
+    }
+#else
+    (void)dirName;
+#endif
+}
+
+//Read the whole of `fileName` into `text`. Returns false if it does not exist
+static bool readFile(const string& fileName, string& text)
+{
+    ifstream ip(fileName, ios::binary);
+    if (!ip.is_open()) {
+        return false;
+    }
+    stringstream ss;
+    ss << ip.rdbuf();
+    text = ss.str();
+    return true;
+}
+
+//A name for a new record that no other writer will pick, in roughly the order they arrive
+static string newToken()
+{
+    static atomic<unsigned> counter{0};
+    auto now = chrono::duration_cast<chrono::nanoseconds>(chrono::system_clock::now().time_since_epoch()).count();
+#ifdef _WIN32
+    long long pid = _getpid();
+#else
+    long long pid = getpid();
+#endif
+    return to_string(now) + "-" + to_string(pid) + "-" + to_string(counter++);
+}
+
+//The index may have fallen behind the database while a batch was being undone or finished
+static void refreshIndex(const string& dataBaseName)
+{
+    if (indexExists(dataBaseName)) {
+        SidIndex index;
+        if (!index.open(dataBaseName)) {
+            buildIndex(dataBaseName);
+        }
+    }
+}
+
+//One record waiting in the spool
+struct Pending {
+    string token;
+    string text;
+    int sid = 0;
+    AppendOutcome outcome = AppendOutcome::FAILED;
+};
+
+//Rename the spool file of each record to its answer
+static void answer(const string& dir, const vector<Pending>& batch)
+{
+    error_code ec;
+    for (const Pending& p : batch) {
+        filesystem::rename(dir + "/" + p.token + ".rec", dir + "/" + p.token + "." + outcomeName(p.outcome), ec);
+    }
+}
+
+//Text of a batch or committed marker: the database size before the batch, then each record's answer
+static string markerText(uint64_t offset, const vector<Pending>& batch)
+{
+    string text = to_string(offset) + "\n";
+    for (const Pending& p : batch) {
+        text += p.token + " " + outcomeName(p.outcome) + "\n";
+    }
+    return text;
+}
+
+bool recoverJournal(const string& dataBaseName)
+{
+    string dir = journalDirName(dataBaseName);
+    string text;
+    error_code ec;
+
+    //The records of a committed batch are safely in the database, only the answers are missing
+    if (readFile(dir + "/committed", text)) {
+        istringstream ip(text);
+        string line;
+        getline(ip, line);
+        while (getline(ip, line)) {
+            size_t space = line.find(' ');
+            if (space != string::npos) {
+                string token = line.substr(0, space);
+                filesystem::rename(dir + "/" + token + ".rec", dir + "/" + token + "." + line.substr(space + 1), ec);
+            }
+        }
+        filesystem::remove(dir + "/committed", ec);
+        refreshIndex(dataBaseName);
+    }
+
+    //An unfinished batch is cut off the end of the database, and its records stay in the spool to be taken again
+    if (readFile(dir + "/batch", text)) {
+        istringstream ip(text);
+        uint64_t offset = 0;
+        if (!(ip >> offset)) {
+            return false;
+        }
+        SourceStamp now;
+        if (sourceStamp(dataBaseName, now) && now.size > offset) {
+            filesystem::resize_file(dataBaseName, offset, ec);
+            if (ec) {
+                return false;
+            }
+        }
+        filesystem::remove(dir + "/batch", ec);
+        refreshIndex(dataBaseName);
+    }
+    return true;
+}
+
+//Append every record waiting in the spool, as one batch. Called with the database lock held
+static void leadBatch(const string& dataBaseName)
+{
+    string dir = journalDirName(dataBaseName);
+    error_code ec;
+    bool recovered = recoverJournal(dataBaseName);
+
+    //Take every waiting record, oldest first
+    vector<Pending> batch;
+    for (const auto& entry : filesystem::directory_iterator(dir, ec)) {
+        if (entry.path().extension() == ".rec") {
+            Pending p;
+            p.token = entry.path().stem().string();
+            batch.push_back(move(p));
+        }
+    }
+    sort(batch.begin(), batch.end(), [](const Pending& a, const Pending& b) { return a.token < b.token; });
+
+    if (!recovered) {
+        answer(dir, batch);
+        return;
+    }
+
+    //Each must be exactly one whole record (so nothing else can be slipped into the database)
+    for (Pending& p : batch) {
+        p.outcome = AppendOutcome::INVALID;
+        Record r;
+        try {
+            if (readFile(dir + "/" + p.token + ".rec", p.text) && !p.text.empty() && p.text.back() == '\n'
+                && parseRecord(p.text, r) && lastRecordTag(p.text) == 0) {
+                p.sid = r.SID;
+                p.outcome = AppendOutcome::ADDED;
+            }
+        }
+        catch (const exception&) {
+        }
+    }
+
+    //Look the student IDs up in the index or snapshot if one is up to date, otherwise scan the database once
+    SidIndex index;
+    Snapshot snapshot;
+    unordered_set<int> existing;
+    bool readable = index.open(dataBaseName) || snapshot.open(dataBaseName);
+    if (!readable) {
+        //The only read of the database, so it is timed as the parse phase of this run (-stats)
+        const char* resume = runStats().currentPhase();
+        runStats().phase("parse");
+        MappedFile file;
+        try {
+            readable = file.open(dataBaseName) && scanRecords(file, [&](int sid, size_t, size_t) {
+                existing.insert(sid);
+                return true;
+            });
+        }
+        catch (const exception&) {
+            readable = false;
+        }
+        runStats().parsed(file.size(), existing.size());
+        runStats().phase(resume);
+    }
+    unordered_set<int> taken;
+    string text;
+    for (Pending& p : batch) {
+        if (p.outcome != AppendOutcome::ADDED) {
+            continue;
+        }
+        RecordSpan span;
+        if (!readable) {
+            p.outcome = AppendOutcome::FAILED;
+        }
+        else if (index.isOpen() ? index.find(p.sid, span)
+                 : snapshot.isOpen() ? snapshot.find(p.sid) >= 0
+                 : existing.count(p.sid) > 0) {
+            p.outcome = AppendOutcome::DUPLICATE;
+        }
+        else if (!taken.insert(p.sid).second) {
+            p.outcome = AppendOutcome::DUPLICATE;
+        }
+        else {
+            text += p.text;
+        }
+    }
+    snapshot.close();
+
+    //Write the batch marker, then everything in one write and one sync, then commit by renaming the marker
+    //(the marker is itself written under another name first, so it is never seen half written)
+    SourceStamp before;
+    if (!text.empty()) {
+        bool ok = sourceStamp(dataBaseName, before)
+                  && writeSynced(dir + "/batch.tmp", markerText(before.size, batch), false);
+        if (ok) {
+            filesystem::rename(dir + "/batch.tmp", dir + "/batch", ec);
+            ok = !ec;
+        }
+        if (ok) {
+            syncDir(dir);
+            ok = writeSynced(dataBaseName, text, true);
+            if (ok) {
+                filesystem::rename(dir + "/batch", dir + "/committed", ec);
+                ok = !ec;
+            }
+            if (ok) {
+                syncDir(dir);
+            }
+            else {
+                index.close();
+                recoverJournal(dataBaseName);
+            }
+        }
+        if (!ok) {
+            for (Pending& p : batch) {
+                if (p.outcome == AppendOutcome::ADDED) {
+                    p.outcome = AppendOutcome::FAILED;
+                }
+            }
+            answer(dir, batch);
+            return;
+        }
+    }
+
+    //Keep the SID index in step with the file (adding may rebuild it, which takes in the whole batch)
+    if (!text.empty()) {
+        bool indexed = !indexExists(dataBaseName) || index.isOpen();
+        RecordSpan span;
+        span.offset = before.size;
+        for (const Pending& p : batch) {
+            if (p.outcome != AppendOutcome::ADDED || !index.isOpen()) {
+                continue;
+            }
+            span.length = p.text.size();
+            if (!index.add(p.sid, span)) {
+                indexed = false;
+                break;
+            }
+            span.offset += span.length;
+        }
+        index.close();
+        if (!indexed) {
+            buildIndex(dataBaseName);
+        }
+    }
+
+    answer(dir, batch);
+    filesystem::remove(dir + "/committed", ec);
+}
+
+AppendOutcome journaledAppend(const string& dataBaseName, const string& recordText)
+{
+    //Put the record in the spool, appearing all at once
+    string dir = journalDirName(dataBaseName);
+    error_code ec;
+    filesystem::create_directories(dir, ec);
+    string token = newToken();
+    string spooled = dir + "/" + token + ".rec";
+    {
+        ofstream op(dir + "/" + token + ".tmp", ios::binary | ios::trunc);
+        op << recordText;
+        op.close();
+        if (op.fail()) {
+            filesystem::remove(dir + "/" + token + ".tmp", ec);
+            return AppendOutcome::FAILED;
+        }
+    }
+    filesystem::rename(dir + "/" + token + ".tmp", spooled, ec);
+    if (ec) {
+        filesystem::remove(dir + "/" + token + ".tmp", ec);
+        return AppendOutcome::FAILED;
+    }
+
+    //Wait for the lock. Another writer may have taken the record in the meantime, otherwise lead a batch
+    DatabaseLock lock;
+    if (!lock.lock(dataBaseName)) {
+        filesystem::remove(spooled, ec);
+        return AppendOutcome::FAILED;
+    }
+    for (int attempt = 0; attempt < 2; attempt++) {
+        for (AppendOutcome outcome : {AppendOutcome::ADDED, AppendOutcome::DUPLICATE, AppendOutcome::INVALID,
+                                      AppendOutcome::FAILED}) {
+            string answered = dir + "/" + token + "." + outcomeName(outcome);
+            if (filesystem::remove(answered, ec)) {
+                return outcome;
+            }
+        }
+        if (attempt == 0) {
+            leadBatch(dataBaseName);
+        }
+    }
+    filesystem::remove(spooled, ec);
+    return AppendOutcome::FAILED;
+}
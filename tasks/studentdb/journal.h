@@ -0,0 +1,47 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+#include <string>
+
+/*
+ * Journaled appends with group commit, for many processes adding records to one database at once
+ *
+ * Each writer drops its record into the spool directory <database>.journal as a file of its own
+ * (written as <token>.tmp, then renamed to <token>.rec so it appears whole), and waits for the
+ * database lock (see dblock.h). Whoever gets the lock first becomes the leader: it takes every
+ * record waiting in the spool, checks their student IDs against the database and each other, and
+ * appends all that are accepted in a single write followed by one fsync. The others find their
+ * answers (<token>.added, .duplicate, .invalid or .failed) waiting when they get the lock in turn,
+ * so the cost of a sync is shared by everyone who arrived while the previous one was running.
+ *
+ * A batch is made safe by two marker files in the spool, both holding the database size before
+ * the batch and the answer for each record:
+ *  batch      written (and synced) before the append. If it is still there, the append may be torn,
+ *             so the database is cut back to that size and the records are taken again
+ *  committed  what batch is renamed to once the append is synced. If it is still there, the records
+ *             are in the database and only their answers are left to give out
+ * Anything that changes the database under the lock should call recoverJournal first.
+ */
+
+//What became of a record given to journaledAppend
+enum class AppendOutcome {
+    ADDED,        //Appended and synced to disk
+    DUPLICATE,    //Its student ID is already in the database (or earlier in the same batch)
+    INVALID,      //The text is not a single valid record
+    FAILED        //The database or the spool could not be read or written
+};
+
+//Functions
+
+//Name of the spool directory for the database `dataBaseName`
+std::string journalDirName(const std::string& dataBaseName);
+
+//Append `recordText` (one record in the database layout, see RecordWriter::writeDatabaseRecord)
+//to `dataBaseName`, unless a record with the same student ID is already there
+//Blocks until the record has been written and synced, possibly by another process
+AppendOutcome journaledAppend(const std::string& dataBaseName, const std::string& recordText);
+
+//Finish or undo a batch left behind by a leader that stopped part way through
+//Must be called with the database lock held. Returns false if the database could not be repaired
+bool recoverJournal(const std::string& dataBaseName);
+
+#endif // JOURNAL_H
@@ -0,0 +1,145 @@
+#include "mappedfile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const string& fileName)
+{
+    close();
+
+    HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        CloseHandle(file);
+        return false;
+    }
+    fileHandle = file;
+    opened = true;
+
+    //An empty file cannot be mapped, but it is still a valid (empty) database
+    if (fileSize.QuadPart == 0) {
+        return true;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL) {
+        close();
+        return false;
+    }
+    mapHandle = mapping;
+
+    data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (data == nullptr) {
+        close();
+        return false;
+    }
+    length = static_cast<size_t>(fileSize.QuadPart);
+    return true;
+}
+
+void MappedFile::release(size_t bytes)
+{
+    //Pages of a read-only view are dropped by the OS when memory is short, so nothing needs doing here
+    (void)bytes;
+}
+
+void MappedFile::close()
+{
+    if (data) {
+        UnmapViewOfFile(data);
+    }
+    if (mapHandle) {
+        CloseHandle(mapHandle);
+    }
+    if (fileHandle) {
+        CloseHandle(fileHandle);
+    }
+    data = nullptr;
+    mapHandle = nullptr;
+    fileHandle = nullptr;
+    length = 0;
+    opened = false;
+}
+
+#else
+
+bool MappedFile::open(const string& fileName)
+{
+    close();
+
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    opened = true;
+
+    //An empty file cannot be mapped, but it is still a valid (empty) database
+    if (st.st_size == 0) {
+        ::close(fd);
+        return true;
+    }
+
+    void* p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    //The mapping stays valid after the descriptor is closed
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        opened = false;
+        return false;
+    }
+
+    //The file is read front to back, so ask the kernel to read ahead aggressively
+    madvise(p, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+
+    data = static_cast<const char*>(p);
+    length = static_cast<size_t>(st.st_size);
+    return true;
+}
+
+void MappedFile::release(size_t bytes)
+{
+    //Only whole pages can be dropped
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    bytes = bytes < length ? bytes : length;
+    bytes -= bytes % page;
+    if (data && bytes > 0) {
+        madvise(const_cast<char*>(data), bytes, MADV_DONTNEED);
+    }
+}
+
+void MappedFile::close()
+{
+    if (data) {
+        munmap(const_cast<char*>(data), length);
+    }
+    data = nullptr;
+    length = 0;
+    opened = false;
+}
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+#include <string>
+#include <string_view>
+
+//Read-only memory mapping of a whole file
+//The contents can be read through view() without copying them into a string
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    //Not copyable - the mapping is owned by exactly one object
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    //Map the file `fileName`. Returns false if the file cannot be opened or mapped
+    bool open(const std::string& fileName);
+
+    //Unmap the file (also done by the destructor)
+    void close();
+
+    //Tell the OS that the first `bytes` of the file will not be read again, so their pages can be dropped
+    //Used when scanning files that are larger than memory
+    void release(size_t bytes);
+
+    bool isOpen() const { return opened; }
+    size_t size() const { return length; }
+    std::string_view view() const { return std::string_view(data, length); }
+
+private:
+    const char* data = nullptr;
+    size_t length = 0;
+    bool opened = false;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mapHandle = nullptr;
+#endif
+};
+
+#endif // MAPPEDFILE_H
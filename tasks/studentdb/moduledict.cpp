@@ -0,0 +1,32 @@
+#include "moduledict.h"
+#include <limits>
+#include <stdexcept>
+using namespace std;
+
+ModuleDictionary::ModuleDictionary()
+{
+    names.reserve(static_cast<size_t>(numeric_limits<ModuleId>::max()) + 1);
+}
+
+ModuleId ModuleDictionary::intern(string_view code)
+{
+    lock_guard<mutex> guard(lock);
+    auto it = ids.find(code);
+    if (it != ids.end()) {
+        return it->second;
+    }
+    if (names.size() > numeric_limits<ModuleId>::max()) {
+        throw runtime_error("Too many different module codes");
+    }
+    ModuleId id = static_cast<ModuleId>(names.size());
+    storage.emplace_back(code);
+    names.push_back(&storage.back());
+    ids.emplace(string_view(storage.back()), id);
+    return id;
+}
+
+ModuleDictionary& moduleDictionary()
+{
+    static ModuleDictionary dictionary;
+    return dictionary;
+}
@@ -0,0 +1,46 @@
+#ifndef MODULEDICT_H
+#define MODULEDICT_H
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+//Compact ID of an interned module code (see moduleId / moduleName)
+using ModuleId = uint16_t;
+
+//Dictionary of every distinct module code seen, each stored once and given a small integer ID
+//There are only a few hundred distinct codes, against millions of enrollments
+class ModuleDictionary {
+public:
+    ModuleDictionary();
+
+    //ID of `code`, adding it to the dictionary if it is new. Safe to call from several threads
+    //Throws std::runtime_error if there are more distinct codes than a ModuleId can hold
+    ModuleId intern(std::string_view code);
+
+    //The code with ID `id`. Safe while another thread is interning, for any ID that thread has already
+    //handed over (the table of codes is allocated at full size up front, so it never moves)
+    const std::string& name(ModuleId id) const { return *names[id]; }
+
+    size_t size() const { return names.size(); }
+
+private:
+    std::mutex lock;
+    std::deque<std::string> storage;                      //The codes themselves (a deque never moves them)
+    std::vector<const std::string*> names;               //ID -> code
+    std::unordered_map<std::string_view, ModuleId> ids;   //code -> ID (the keys point into storage)
+};
+
+//Functions
+
+//The dictionary shared by every record in the program
+ModuleDictionary& moduleDictionary();
+
+//Shorthands for moduleDictionary().intern(code) and moduleDictionary().name(id)
+inline ModuleId moduleId(std::string_view code) { return moduleDictionary().intern(code); }
+inline const std::string& moduleName(ModuleId id) { return moduleDictionary().name(id); }
+
+#endif // MODULEDICT_H
@@ -0,0 +1,67 @@
+#include "numparse.h"
+#include <charconv>
+#include <cmath>
+using namespace std;
+
+//Convert the outcome of std::from_chars into a NumberResult
+static NumberResult checkParse(string_view text, const from_chars_result& r)
+{
+    NumberResult result;
+    result.position = static_cast<size_t>(r.ptr - text.data());
+    if (text.empty()) {
+        result.error = NumberError::EMPTY;
+    } else if (r.ec == errc::invalid_argument) {
+        result.error = NumberError::INVALID;
+    } else if (r.ec == errc::result_out_of_range) {
+        result.error = NumberError::OUT_OF_RANGE;
+    } else if (r.ptr != text.data() + text.size()) {
+        result.error = NumberError::TRAILING;
+    }
+    return result;
+}
+
+NumberResult parseInt(string_view text, int& value)
+{
+    int parsed = 0;
+    NumberResult result = checkParse(text, from_chars(text.data(), text.data() + text.size(), parsed));
+    if (result.ok()) {
+        value = parsed;
+    }
+    return result;
+}
+
+NumberResult parseFloat(string_view text, float& value)
+{
+    float parsed = 0;
+    NumberResult result = checkParse(text, from_chars(text.data(), text.data() + text.size(), parsed));
+    //from_chars also accepts "inf" and "nan", which are not grades
+    if (result.ok() && !isfinite(parsed)) {
+        result.error = NumberError::INVALID;
+        result.position = 0;
+    }
+    if (result.ok()) {
+        value = parsed;
+    }
+    return result;
+}
+
+string numberErrorMessage(const NumberResult& result, string_view text, const string& what)
+{
+    string message = "Invalid " + what + " " + string(text);
+    switch (result.error)
+    {
+    case NumberError::NONE:
+        break;
+    case NumberError::EMPTY:
+        message += "(missing)";
+        break;
+    case NumberError::INVALID:
+    case NumberError::TRAILING:
+        message += " (unexpected '" + string(1, text[result.position]) + "' at character " + to_string(result.position + 1) + ")";
+        break;
+    case NumberError::OUT_OF_RANGE:
+        message += " (out of range)";
+        break;
+    }
+    return message;
+}
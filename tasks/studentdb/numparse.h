@@ -0,0 +1,46 @@
+#ifndef NUMPARSE_H
+#define NUMPARSE_H
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/*
+ * Allocation-free number parsing for student IDs and grades
+ *
+ * These work on a string_view in place (in the style of std::from_chars): nothing is copied, no locale
+ * is consulted and no exception is thrown. The whole of the text must be the number - leading or
+ * trailing characters are an error - and the result says exactly what went wrong and where.
+ */
+
+//What went wrong while parsing a number
+enum class NumberError {
+    NONE,           //Parsed successfully
+    EMPTY,          //There was no text
+    INVALID,        //The text does not start with a number
+    TRAILING,       //A number was followed by other characters
+    OUT_OF_RANGE    //The number does not fit in the type
+};
+
+//Result of parseInt / parseFloat. `position` is the offset of the first character that could not be used
+struct NumberResult {
+    NumberError error = NumberError::NONE;
+    size_t position = 0;
+
+    bool ok() const { return error == NumberError::NONE; }
+};
+
+//Functions
+
+//Parse all of `text` as a decimal integer (optionally negative) into `value`
+//`value` is only changed on success
+NumberResult parseInt(std::string_view text, int& value);
+
+//Parse all of `text` as a finite decimal number such as 65 or 72.5 into `value`
+//`value` is only changed on success
+NumberResult parseFloat(std::string_view text, float& value);
+
+//Describe a failed parse of `text`, e.g. "Invalid grade 7x.5 (unexpected 'x' at character 2)"
+//`what` names the value, e.g. "student ID" or "grade"
+std::string numberErrorMessage(const NumberResult& result, std::string_view text, const std::string& what);
+
+#endif // NUMPARSE_H
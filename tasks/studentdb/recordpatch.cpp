@@ -0,0 +1,126 @@
+#include "recordpatch.h"
+#include <fstream>
+#include <sstream>
+#include "dbparser.h"
+#include "mappedfile.h"
+#include "recordwriter.h"
+#include "snapshot.h"
+using namespace std;
+
+bool locateRecord(const string& dataBaseName, int sid, RecordSpan& slot, size_t* scanned)
+{
+    if (scanned != nullptr) {
+        *scanned = 0;
+    }
+    SidIndex index;
+    if (index.open(dataBaseName)) {
+        return index.find(sid, slot);
+    }
+
+    MappedFile file;
+    if (!file.open(dataBaseName)) {
+        return false;
+    }
+    bool found = false;
+    scanRecords(file, [&](int recordSID, size_t offset, size_t length) {
+        if (recordSID != sid) {
+            return true;
+        }
+        slot.offset = offset;
+        slot.length = length;
+        found = true;
+        return false;
+    });
+    if (scanned != nullptr) {
+        *scanned = found ? static_cast<size_t>(slot.offset + slot.length) : file.size();
+    }
+    return found;
+}
+
+//Write `text` over the bytes of `dataBaseName` from `offset` on
+static bool writeAt(const string& dataBaseName, uint64_t offset, const string& text)
+{
+    fstream file(dataBaseName, ios::in | ios::out | ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    file.seekp(static_cast<streamoff>(offset));
+    file.write(text.data(), static_cast<streamsize>(text.size()));
+    file.close();
+    return !file.fail();
+}
+
+PatchOutcome patchRecord(const string& dataBaseName, const RecordSpan& slot, const RecordView& r)
+{
+    //The index is opened before the file changes, while it still matches
+    SidIndex index;
+    bool indexed = index.open(dataBaseName);
+
+    //The record without slack, to see whether it fits
+    stringstream formatted;
+    {
+        RecordWriter out(formatted);
+        out.writeDatabaseRecord(r, 0);
+    }
+    string text = formatted.str();
+    text.pop_back();
+
+    PatchOutcome outcome;
+    RecordSpan moved = slot;
+    if (text.size() <= slot.length) {
+        //Pad it out to the old length. The slot always ends a line, so the next #RECORD stays on a line of its own
+        if (text.size() < slot.length) {
+            text.append(slot.length - text.size() - 1, ' ');
+            text += '\n';
+        }
+        if (!writeAt(dataBaseName, slot.offset, text)) {
+            return PatchOutcome::FAILED;
+        }
+        outcome = PatchOutcome::IN_PLACE;
+    }
+    else {
+        //Append the new copy first, so a failure part way leaves the old one in place
+        SourceStamp before;
+        if (!sourceStamp(dataBaseName, before)) {
+            return PatchOutcome::FAILED;
+        }
+        string lastByte(1, '\n');
+        if (before.size > 0) {
+            ifstream ip(dataBaseName, ios::binary);
+            ip.seekg(static_cast<streamoff>(before.size - 1));
+            ip.get(lastByte[0]);
+        }
+        text += string(RecordWriter::RECORD_SLACK, ' ') + "\n";
+        if (lastByte[0] != '\n') {
+            text.insert(text.begin(), '\n');
+        }
+        ofstream op(dataBaseName, ios::app | ios::binary);
+        op << text;
+        op.close();
+        if (op.fail()) {
+            return PatchOutcome::FAILED;
+        }
+        moved.offset = before.size + (lastByte[0] != '\n');
+        moved.length = text.size() - (lastByte[0] != '\n');
+
+        //Then blank out the old slot, keeping its final newline
+        string tombstone(slot.length, ' ');
+        tombstone.back() = '\n';
+        if (!writeAt(dataBaseName, slot.offset, tombstone)) {
+            return PatchOutcome::FAILED;
+        }
+        outcome = PatchOutcome::RELOCATED;
+    }
+
+    //Keep the SID index in step with the file
+    if (indexed) {
+        if (!index.update(r.SID, moved)) {
+            index.close();
+            buildIndex(dataBaseName);
+        }
+    }
+    else if (indexExists(dataBaseName)) {
+        buildIndex(dataBaseName);
+    }
+    return outcome;
+}
@@ -0,0 +1,37 @@
+#ifndef RECORDPATCH_H
+#define RECORDPATCH_H
+#include <string>
+#include "recordstore.h"
+#include "sidindex.h"
+
+/*
+ * Changing one record of a text database where it lies, without rewriting the rest of the file
+ *
+ * A record's slot runs from its #RECORD tag to the next one. Records are written with slack (the blank
+ * line after each one holds spaces, see RecordWriter::writeDatabaseRecord), and every reader skips
+ * blank lines. So a changed record that still fits its slot is written over the old one, padded with
+ * spaces to the same length, and nothing else in the file moves. A record that has outgrown its slot
+ * is appended to the end of the file with fresh slack, and the old slot is then overwritten with
+ * spaces: a blank tombstone that readers skip, and that the record before it can later grow into.
+ */
+
+//How patchRecord changed the file
+enum class PatchOutcome {
+    IN_PLACE,     //The record was written over its old slot
+    RELOCATED,    //The record was moved to the end of the file, leaving a tombstone
+    FAILED        //The file could not be written
+};
+
+//Functions
+
+//Find the slot of the first record with student ID `sid` in `dataBaseName`, through the SID index
+//if it is up to date, otherwise by scanning the student IDs (see scanRecords)
+//If `scanned` is given, it is set to the number of bytes scanned (0 when the index was used)
+//Returns false if there is none. Throws std::runtime_error if the database is malformed
+bool locateRecord(const std::string& dataBaseName, int sid, RecordSpan& slot, size_t* scanned = nullptr);
+
+//Replace the record in `slot` (as found by locateRecord) with `r`, which has the same student ID
+//The SID index, if there is one, is kept in step. The caller must hold the database lock (see dblock.h)
+PatchOutcome patchRecord(const std::string& dataBaseName, const RecordSpan& slot, const RecordView& r);
+
+#endif // RECORDPATCH_H
@@ -0,0 +1,160 @@
+#include "recordstore.h"
+#include <algorithm>
+#include <stdexcept>
+using namespace std;
+
+template <typename T>
+RecordStore::Slice RecordStore::push(vector<T>& arena, const T* items, size_t count)
+{
+    if (arena.size() + count > UINT32_MAX) {
+        throw runtime_error("Database too large for the record store");
+    }
+    Slice s{static_cast<uint32_t>(arena.size()), static_cast<uint32_t>(count)};
+    arena.insert(arena.end(), items, items + count);
+    return s;
+}
+
+RecordStore::Slice RecordStore::push(string& arena, string_view text)
+{
+    if (arena.size() + text.size() > UINT32_MAX) {
+        throw runtime_error("Database too large for the record store");
+    }
+    Slice s{static_cast<uint32_t>(arena.size()), static_cast<uint32_t>(text.size())};
+    arena.append(text.data(), text.size());
+    return s;
+}
+
+void RecordStore::reserve(size_t records)
+{
+    sids.reserve(sids.size() + records);
+    nameSlices.reserve(nameSlices.size() + records);
+    phoneSlices.reserve(phoneSlices.size() + records);
+    enrollmentSlices.reserve(enrollmentSlices.size() + records);
+    gradeSlices.reserve(gradeSlices.size() + records);
+}
+
+void RecordStore::clear()
+{
+    *this = RecordStore();
+}
+
+void RecordStore::add(const RecordView& r)
+{
+    sids.push_back(r.SID);
+    nameSlices.push_back(push(names, r.name));
+    phoneSlices.push_back(push(phones, r.phone));
+    enrollmentSlices.push_back(push(enrollments, r.enrollments.items, r.enrollments.count));
+    gradeSlices.push_back(push(grades, r.grades.items, r.grades.count));
+}
+
+void RecordStore::add(const Record& r)
+{
+    add(viewOf(r));
+}
+
+void RecordStore::append(const RecordStore& other)
+{
+    reserve(other.size());
+    for (size_t n = 0; n < other.size(); n++) {
+        add(other[n]);
+    }
+}
+
+void RecordStore::truncate(size_t records)
+{
+    //Records are laid out in order in the arenas until one is changed, so the removed values can be
+    //given back by cutting the arenas where the first removed record starts
+    if (records < sids.size() && !changed) {
+        names.resize(nameSlices[records].offset);
+        phones.resize(phoneSlices[records].offset);
+        enrollments.resize(enrollmentSlices[records].offset);
+        grades.resize(gradeSlices[records].offset);
+    }
+
+    if (records < sids.size()) {
+        sids.resize(records);
+        nameSlices.resize(records);
+        phoneSlices.resize(records);
+        enrollmentSlices.resize(records);
+        gradeSlices.resize(records);
+    }
+}
+
+RecordView RecordStore::operator[](size_t n) const
+{
+    RecordView v;
+    v.SID = sids[n];
+    v.name = string_view(names.data() + nameSlices[n].offset, nameSlices[n].length);
+    v.phone = string_view(phones.data() + phoneSlices[n].offset, phoneSlices[n].length);
+    v.enrollments = {enrollments.data() + enrollmentSlices[n].offset, enrollmentSlices[n].length};
+    v.grades = {grades.data() + gradeSlices[n].offset, gradeSlices[n].length};
+    return v;
+}
+
+Record RecordStore::record(size_t n) const
+{
+    RecordView v = (*this)[n];
+    Record r{};
+    r.SID = v.SID;
+    r.name = v.name;
+    r.enrollments.assign(v.enrollments.begin(), v.enrollments.end());
+    r.grades.assign(v.grades.begin(), v.grades.end());
+    r.phone = v.phone;
+    return r;
+}
+
+long long RecordStore::find(int sid) const
+{
+    auto it = std::find(sids.begin(), sids.end(), sid);
+    return it == sids.end() ? -1 : static_cast<long long>(it - sids.begin());
+}
+
+void RecordStore::setName(size_t n, string_view name)
+{
+    nameSlices[n] = push(names, name);
+    changed = true;
+}
+
+void RecordStore::setPhone(size_t n, string_view phone)
+{
+    phoneSlices[n] = push(phones, phone);
+    changed = true;
+}
+
+void RecordStore::setLists(size_t n, const vector<ModuleId>& newEnrollments, const vector<float>& newGrades)
+{
+    enrollmentSlices[n] = push(enrollments, newEnrollments.data(), newEnrollments.size());
+    gradeSlices[n] = push(grades, newGrades.data(), newGrades.size());
+    changed = true;
+}
+
+size_t RecordStore::memoryUsed() const
+{
+    return sids.capacity() * sizeof(int)
+         + (nameSlices.capacity() + phoneSlices.capacity() + enrollmentSlices.capacity() + gradeSlices.capacity()) * sizeof(Slice)
+         + names.capacity() + phones.capacity()
+         + enrollments.capacity() * sizeof(ModuleId) + grades.capacity() * sizeof(float);
+}
+
+unordered_map<int, size_t> indexBySid(const RecordStore& db)
+{
+    const vector<int>& sids = db.sidColumn();
+    unordered_map<int, size_t> positions;
+    positions.reserve(sids.size());
+    for (size_t n = 0; n < sids.size(); n++) {
+        //emplace keeps the first record with an ID, as every other lookup does
+        positions.emplace(sids[n], n);
+    }
+    return positions;
+}
+
+RecordView viewOf(const Record& r)
+{
+    RecordView v;
+    v.SID = r.SID;
+    v.name = r.name;
+    v.phone = r.phone;
+    v.enrollments = {r.enrollments.data(), r.enrollments.size()};
+    v.grades = {r.grades.data(), r.grades.size()};
+    return v;
+}
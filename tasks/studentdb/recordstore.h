@@ -0,0 +1,116 @@
+#ifndef RECORDSTORE_H
+#define RECORDSTORE_H
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "moduledict.h"
+#include "studentrecord.h"
+
+//Read-only view of a run of values (the parts of a record held in a RecordStore's lists)
+template <typename T>
+struct ArrayView {
+    const T* items = nullptr;
+    size_t count = 0;
+
+    const T* begin() const { return items; }
+    const T* end() const { return items + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const T& operator[](size_t i) const { return items[i]; }
+};
+
+//One record, pointing into the storage of a RecordStore (or a Record)
+//Only valid until the store is changed
+struct RecordView {
+    int SID = 0;
+    std::string_view name;
+    ArrayView<ModuleId> enrollments;
+    ArrayView<float> grades;
+    std::string_view phone;
+};
+
+/*
+ * Column-oriented container for a whole database
+ *
+ * Each field is held in its own contiguous column, so a scan over one field across every student
+ * reads only that field. Names, phones, enrollment lists and grade lists are appended to one
+ * growing buffer ("arena") per field and located by offset and length, so adding a record
+ * does not allocate memory of its own.
+ */
+class RecordStore {
+public:
+    size_t size() const { return sids.size(); }
+    bool empty() const { return sids.empty(); }
+
+    //Make room for `records` more records
+    void reserve(size_t records);
+    void clear();
+
+    //Add a record at the end
+    void add(const RecordView& r);
+    void add(const Record& r);
+
+    //Add every record of `other` at the end
+    void append(const RecordStore& other);
+
+    //Remove every record from number `records` on
+    void truncate(size_t records);
+
+    //View of record number `n`
+    RecordView operator[](size_t n) const;
+
+    //Copy of record number `n`
+    Record record(size_t n) const;
+
+    //Position of the first record with student ID `sid`, or -1 if there is none
+    long long find(int sid) const;
+
+    //Replace parts of record number `n`. The old values are left unused in the arenas
+    void setName(size_t n, std::string_view name);
+    void setPhone(size_t n, std::string_view phone);
+    void setLists(size_t n, const std::vector<ModuleId>& enrollments, const std::vector<float>& grades);
+
+    //Columns, for scans across every record
+    const std::vector<int>& sidColumn() const { return sids; }
+    const std::vector<float>& gradeArena() const { return grades; }
+    const std::vector<ModuleId>& enrollmentArena() const { return enrollments; }
+
+    //Bytes of memory held by the store
+    size_t memoryUsed() const;
+
+private:
+    //Position of one value in an arena
+    struct Slice {
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    template <typename T>
+    static Slice push(std::vector<T>& arena, const T* items, size_t count);
+    static Slice push(std::string& arena, std::string_view text);
+
+    std::vector<int> sids;
+    std::vector<Slice> nameSlices;
+    std::vector<Slice> phoneSlices;
+    std::vector<Slice> enrollmentSlices;
+    std::vector<Slice> gradeSlices;
+
+    std::string names;
+    std::string phones;
+    std::vector<ModuleId> enrollments;
+    std::vector<float> grades;
+
+    bool changed = false;   //Has a record been changed since it was added (see truncate)?
+};
+
+//Functions
+
+//Position of the first record with each student ID in `db`, for answering many lookups from one load
+std::unordered_map<int, size_t> indexBySid(const RecordStore& db);
+
+//View of a Record (valid while the Record is unchanged)
+RecordView viewOf(const Record& r);
+
+#endif // RECORDSTORE_H
@@ -0,0 +1,177 @@
+#include "recordwriter.h"
+#include <charconv>
+#include <iostream>
+using namespace std;
+
+RecordWriter::RecordWriter(ostream& out, size_t blockSize, bool background)
+    : out(out), blockSize(blockSize), background(background)
+{
+    if (background) {
+        writer = thread(&RecordWriter::writeBlocks, this);
+    }
+}
+
+RecordWriter::~RecordWriter()
+{
+    flush();
+    if (background) {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        changed.notify_all();
+        writer.join();
+    }
+}
+
+RecordWriter& RecordWriter::operator<<(string_view text)
+{
+    buffer.append(text.data(), text.size());
+    blockFull();
+    return *this;
+}
+
+RecordWriter& RecordWriter::operator<<(char c)
+{
+    buffer.push_back(c);
+    blockFull();
+    return *this;
+}
+
+RecordWriter& RecordWriter::operator<<(int value)
+{
+    char digits[16];
+    auto [end, ec] = to_chars(digits, digits + sizeof(digits), value);
+    buffer.append(digits, end - digits);
+    blockFull();
+    return *this;
+}
+
+RecordWriter& RecordWriter::operator<<(size_t value)
+{
+    char digits[24];
+    auto [end, ec] = to_chars(digits, digits + sizeof(digits), value);
+    buffer.append(digits, end - digits);
+    blockFull();
+    return *this;
+}
+
+RecordWriter& RecordWriter::operator<<(float value)
+{
+    //A stream writes a float as a double in "%g" style with 6 significant digits
+    char digits[32];
+    auto [end, ec] = to_chars(digits, digits + sizeof(digits), static_cast<double>(value), chars_format::general, 6);
+    buffer.append(digits, end - digits);
+    blockFull();
+    return *this;
+}
+
+void RecordWriter::writeRecord(const RecordView& r)
+{
+    *this << "SID:\n";
+    *this << "   " << r.SID << '\n';
+    *this << "NAME:\n";
+    *this << "   " << r.name << '\n';
+    *this << "ENROLLMENTS:\n";
+    *this << "   ";
+    for (ModuleId id : r.enrollments) {
+        *this << moduleName(id) << ' ';
+    }
+    *this << '\n';
+    *this << "GRADES:\n";
+    *this << "   ";
+    for (float g : r.grades) {
+        *this << g << ' ';
+    }
+    *this << '\n';
+    if (!r.phone.empty()) {
+        *this << "PHONE:\n";
+        *this << "   " << r.phone << '\n';
+    }
+}
+
+void RecordWriter::writeDatabaseRecord(const RecordView& r, size_t slack)
+{
+    *this << "#RECORD\n";
+    *this << " #SID\n";
+    *this << "     " << r.SID << '\n';
+    *this << " #NAME\n";
+    *this << "     " << r.name << '\n';
+    if (!r.enrollments.empty()) {
+        *this << " #ENROLLMENTS\n";
+        *this << "    ";
+        for (ModuleId id : r.enrollments) {
+            *this << ' ' << moduleName(id);
+        }
+        *this << '\n';
+    }
+    if (!r.grades.empty()) {
+        *this << " #GRADES\n";
+        *this << "    ";
+        for (float g : r.grades) {
+            *this << ' ' << g;
+        }
+        *this << '\n';
+    }
+    if (!r.phone.empty()) {
+        *this << " #PHONE\n";
+        *this << "     " << r.phone << '\n';
+    }
+    //Every reader skips a line of spaces, so the slack costs nothing but the bytes
+    buffer.append(slack, ' ');
+    *this << '\n';
+}
+
+void RecordWriter::passOn()
+{
+    if (!background) {
+        out.write(buffer.data(), static_cast<streamsize>(buffer.size()));
+        buffer.clear();
+        return;
+    }
+
+    //Wait for the writer thread to finish the last block, then swap buffers with it
+    unique_lock<mutex> guard(lock);
+    changed.wait(guard, [this] { return !hasPending; });
+    swap(buffer, pending);
+    hasPending = true;
+    guard.unlock();
+    changed.notify_all();
+    buffer.clear();
+}
+
+void RecordWriter::flush()
+{
+    if (!buffer.empty()) {
+        passOn();
+    }
+    if (background) {
+        unique_lock<mutex> guard(lock);
+        changed.wait(guard, [this] { return !hasPending; });
+    }
+    out.flush();
+}
+
+void RecordWriter::writeBlocks()
+{
+    unique_lock<mutex> guard(lock);
+    while (true) {
+        changed.wait(guard, [this] { return hasPending || stopping; });
+        if (!hasPending) {
+            return;
+        }
+        guard.unlock();
+        out.write(pending.data(), static_cast<streamsize>(pending.size()));
+        guard.lock();
+        pending.clear();
+        hasPending = false;
+        changed.notify_all();
+    }
+}
+
+//Function to display a record in the terminal
+void printRecord(const RecordView& r)
+{
+    RecordWriter out(cout);
+    out.writeRecord(r);
+}
@@ -0,0 +1,88 @@
+#ifndef RECORDWRITER_H
+#define RECORDWRITER_H
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include "recordstore.h"
+
+/*
+ * Buffered output for records and query results
+ *
+ * Text is built up in one reusable buffer, with numbers formatted in place by std::to_chars, and
+ * passed to the stream in large blocks instead of being flushed line by line. The text is exactly
+ * what writing the same values to a std::ostream with default formatting would give.
+ * Optionally the blocks are written by a second thread, so formatting and writing overlap.
+ *
+ * Anything written to the stream directly must wait until flush() has been called.
+ */
+class RecordWriter {
+public:
+    //Size of the blocks passed to the stream
+    static const size_t BLOCK_SIZE = 1 << 20;
+
+    //Spaces left after each record written by writeDatabaseRecord, so it can grow in place (see recordpatch.h)
+    //Enough for a phone number, or a couple more modules and grades
+    static const size_t RECORD_SLACK = 32;
+
+    //Write to `out` in blocks of about `blockSize` bytes, from a separate thread if `background` is set
+    explicit RecordWriter(std::ostream& out, size_t blockSize = BLOCK_SIZE, bool background = false);
+    ~RecordWriter();
+
+    RecordWriter(const RecordWriter&) = delete;
+    RecordWriter& operator=(const RecordWriter&) = delete;
+
+    RecordWriter& operator<<(std::string_view text);
+    RecordWriter& operator<<(char c);
+    RecordWriter& operator<<(int value);
+    RecordWriter& operator<<(size_t value);
+    RecordWriter& operator<<(float value);
+
+    //Write a record in the layout of printRecord
+    void writeRecord(const RecordView& r);
+
+    //Write a record in the layout of the database file, followed by a blank line of `slack` spaces
+    //ENROLLMENTS, GRADES and PHONE are left out when empty
+    void writeDatabaseRecord(const RecordView& r, size_t slack = RECORD_SLACK);
+
+    //Pass everything written so far to the stream, and wait until it has been written
+    void flush();
+
+private:
+    //Pass a full buffer on once it reaches the block size
+    void blockFull()
+    {
+        if (buffer.size() >= blockSize) {
+            passOn();
+        }
+    }
+
+    //Pass the buffer to the stream (or to the writer thread)
+    void passOn();
+
+    //Body of the writer thread
+    void writeBlocks();
+
+    std::ostream& out;
+    size_t blockSize;
+    std::string buffer;
+
+    //Hand over between this thread and the writer thread
+    bool background;
+    std::thread writer;
+    std::mutex lock;
+    std::condition_variable changed;
+    std::string pending;            //Block being written by the writer thread
+    bool hasPending = false;
+    bool stopping = false;
+};
+
+//Functions
+
+//Display a record in the terminal
+void printRecord(const RecordView& r);
+
+#endif // RECORDWRITER_H
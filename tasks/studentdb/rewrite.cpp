@@ -0,0 +1,219 @@
+#include "rewrite.h"
+#include <algorithm>
+#include <filesystem>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include "dbparser.h"
+#include "mappedfile.h"
+#include "recordstore.h"
+#include "recordwriter.h"
+#include "sidindex.h"
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+//The new database as it is written: text written straight to the file, and byte ranges of the old one copied
+//by the kernel where it can (copy_file_range), otherwise from the old file's mapping
+class RewriteOutput {
+public:
+    RewriteOutput(const MappedFile& source, const string& sourceName, const string& fileName);
+    ~RewriteOutput();
+
+    bool isOpen() const { return fd >= 0; }
+
+    //Write `text`. Returns false if it could not be written
+    bool write(string_view text);
+
+    //Copy `length` bytes of the old file, starting at `offset`
+    bool copy(size_t offset, size_t length);
+
+    //Sync the file to disk and close it
+    bool finish();
+
+private:
+    const MappedFile& source;
+    int fd = -1;
+#ifndef _WIN32
+    int sourceFd = -1;
+#endif
+};
+
+RewriteOutput::RewriteOutput(const MappedFile& source, const string& sourceName, const string& fileName)
+    : source(source)
+{
+#ifdef _WIN32
+    (void)sourceName;
+    fd = _open(fileName.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    fd = ::open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#if defined(__linux__)
+    sourceFd = ::open(sourceName.c_str(), O_RDONLY);
+#else
+    (void)sourceName;
+#endif
+#endif
+}
+
+RewriteOutput::~RewriteOutput()
+{
+#ifdef _WIN32
+    if (fd >= 0) {
+        _close(fd);
+    }
+#else
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    if (sourceFd >= 0) {
+        ::close(sourceFd);
+    }
+#endif
+}
+
+bool RewriteOutput::write(string_view text)
+{
+    while (!text.empty()) {
+#ifdef _WIN32
+        int written = _write(fd, text.data(), static_cast<unsigned>(min<size_t>(text.size(), 1u << 30)));
+#else
+        ssize_t written = ::write(fd, text.data(), text.size());
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+#endif
+        if (written <= 0) {
+            return false;
+        }
+        text.remove_prefix(static_cast<size_t>(written));
+    }
+    return true;
+}
+
+bool RewriteOutput::copy(size_t offset, size_t length)
+{
+#if defined(__linux__)
+    //Let the kernel move the bytes (or share the blocks, on file systems that can). If it cannot do so between
+    //these two files, the rest is copied from the mapping instead
+    while (sourceFd >= 0 && length > 0) {
+        off64_t from = static_cast<off64_t>(offset);
+        ssize_t copied = copy_file_range(sourceFd, &from, fd, nullptr, length, 0);
+        if (copied < 0 && errno == EINTR) {
+            continue;
+        }
+        if (copied <= 0) {
+            ::close(sourceFd);
+            sourceFd = -1;
+            break;
+        }
+        offset += static_cast<size_t>(copied);
+        length -= static_cast<size_t>(copied);
+    }
+#endif
+    return write(source.view().substr(offset, length));
+}
+
+bool RewriteOutput::finish()
+{
+#ifdef _WIN32
+    bool ok = _commit(fd) == 0;
+    ok = _close(fd) == 0 && ok;
+#else
+    bool ok = fsync(fd) == 0;
+    ok = ::close(fd) == 0 && ok;
+#endif
+    fd = -1;
+    return ok;
+}
+
+//Make the rename of the new database durable (directories cannot be synced on Windows, nor need to be)
+static void syncParentDir(const string& fileName)
+{
+#ifndef _WIN32
+    string dirName = filesystem::path(fileName).parent_path().string();
+    int fd = ::open(dirName.empty() ? "." : dirName.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        ::close(fd);
+    }
+#else
+    (void)fileName;
+#endif
+}
+
+size_t rewriteDatabase(const string& dataBaseName, const unordered_set<int>& sids, const function<void(Record&)>& edit)
+{
+    MappedFile file;
+    if (!file.open(dataBaseName)) {
+        throw runtime_error("Cannot open file " + dataBaseName);
+    }
+    string tempName = dataBaseName + ".rewrite.tmp";
+    RewriteOutput out(file, dataBaseName, tempName);
+    if (!out.isOpen()) {
+        throw runtime_error("Cannot write " + tempName);
+    }
+    error_code ec;
+    auto fail = [&](const string& what) {
+        out.finish();
+        filesystem::remove(tempName, ec);
+        return runtime_error(what);
+    };
+
+    //Everything up to the next record to change is copied in one go, then that record is written afresh
+    string_view text = file.view();
+    unordered_set<int> done;
+    size_t copied = 0;
+    bool written = true;
+    try {
+        scanRecords(file, [&](int sid, size_t offset, size_t length) {
+            if (!sids.count(sid) || !done.insert(sid).second) {
+                return true;
+            }
+            Record r;
+            if (!parseRecord(text.substr(offset, length), r)) {
+                throw runtime_error("Cannot read the record of student " + to_string(sid));
+            }
+            edit(r);
+            ostringstream record;
+            {
+                RecordWriter writer(record);
+                writer.writeDatabaseRecord(viewOf(r));
+            }
+            written = out.copy(copied, offset - copied) && out.write(record.str());
+            copied = offset + length;
+            return written;
+        });
+    }
+    catch (const exception& e) {
+        throw fail(e.what());
+    }
+    written = written && out.copy(copied, text.size() - copied);
+    if (!written || !out.finish()) {
+        throw fail("Cannot write " + tempName);
+    }
+    file.close();
+
+    //Swap the new file in whole
+    filesystem::rename(tempName, dataBaseName, ec);
+    if (ec) {
+        string why = ec.message();
+        filesystem::remove(tempName, ec);
+        throw runtime_error("Cannot replace " + dataBaseName + " - " + why);
+    }
+    syncParentDir(dataBaseName);
+
+    //Records after a changed one may have moved. A snapshot falls out of date by itself (see loadDatabase)
+    if (indexExists(dataBaseName)) {
+        buildIndex(dataBaseName);
+    }
+    return done.size();
+}
@@ -0,0 +1,28 @@
+#ifndef REWRITE_H
+#define REWRITE_H
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <unordered_set>
+#include "studentrecord.h"
+
+/*
+ * Rewriting a text database when some of its records change
+ *
+ * The old file is streamed to a new one beside it. Only the records being changed are parsed and written
+ * afresh; the text between them is copied byte for byte in as few large copies as possible (by the kernel,
+ * with copy_file_range, where there is one), so a rewrite costs little more than copying the file and
+ * needs no more memory however large it is. The new file is synced to disk and then renamed over the old,
+ * so a reader, or a crash, only ever sees the old database or the new one - never half of one.
+ */
+
+//Functions
+
+//Rewrite `dataBaseName`, passing the first record of each student in `sids` through `edit`
+//Returns the number of records changed. The SID index, if there is one, is rebuilt. The caller must hold
+//the database lock (see dblock.h). Throws std::runtime_error if the database is malformed or cannot be
+//read, or the new file cannot be written (the old one is then left as it was)
+size_t rewriteDatabase(const std::string& dataBaseName, const std::unordered_set<int>& sids,
+                       const std::function<void(Record&)>& edit);
+
+#endif // REWRITE_H
@@ -0,0 +1,142 @@
+#include "runstats.h"
+#include <atomic>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace std;
+
+AllocationCounters allocationCounters;
+
+RunStats::~RunStats()
+{
+    if (on && !reported) {
+        report(cerr);
+    }
+}
+
+void RunStats::enable(const string& tool, const char* phase)
+{
+    this->tool = tool;
+    on = true;
+    start = Clock::now();
+    phaseStart = start;
+    current = phase;
+    allocationCounters.calls = 0;
+    allocationCounters.counting = true;
+}
+
+void RunStats::startPhase(const char* name)
+{
+    Clock::time_point now = Clock::now();
+    double seconds = chrono::duration<double>(now - phaseStart).count();
+    phaseStart = now;
+
+    if (current != nullptr) {
+        auto it = phases.begin();
+        while (it != phases.end() && strcmp(it->first, current) != 0) {
+            ++it;
+        }
+        if (it == phases.end()) {
+            phases.emplace_back(current, seconds);
+        } else {
+            it->second += seconds;
+        }
+    }
+    current = name;
+}
+
+void RunStats::countParse(uint64_t bytes, size_t records)
+{
+    parseBytes += bytes;
+    parseRecords += records;
+    if (current == nullptr) {
+        return;
+    }
+
+    auto it = parsePhases.begin();
+    while (it != parsePhases.end() && strcmp(*it, current) != 0) {
+        ++it;
+    }
+    if (it == parsePhases.end()) {
+        parsePhases.push_back(current);
+    }
+}
+
+void RunStats::setText(const char* key, const string& value)
+{
+    for (auto& [name, text] : extra) {
+        if (name == key) {
+            text = value;
+            return;
+        }
+    }
+    extra.emplace_back(key, value);
+}
+
+void RunStats::report(ostream& op)
+{
+    if (!on) {
+        return;
+    }
+    startPhase(nullptr);
+    reported = true;
+
+    double parseSeconds = 0;
+    op << "stats_tool=" << tool;
+    for (const auto& [name, seconds] : phases) {
+        op << " phase_" << name << "_seconds=" << seconds;
+        for (const char* parsing : parsePhases) {
+            if (strcmp(name, parsing) == 0) {
+                parseSeconds += seconds;
+            }
+        }
+    }
+    op << " total_seconds=" << chrono::duration<double>(Clock::now() - start).count()
+       << " parse_bytes=" << parseBytes
+       << " parse_records=" << parseRecords
+       << " parse_mb_per_s=" << (parseSeconds > 0 ? parseBytes / 1e6 / parseSeconds : 0)
+       << " parse_records_per_s=" << (parseSeconds > 0 ? parseRecords / parseSeconds : 0)
+       << " peak_rss_bytes=" << peakResidentBytes()
+       << " allocations=" << allocationCount();
+    for (const auto& [key, value] : extra) {
+        op << " " << key << "=" << value;
+    }
+    op << endl;
+}
+
+RunStats& runStats()
+{
+    static RunStats stats;
+    return stats;
+}
+
+size_t peakResidentBytes()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.PeakWorkingSetSize;
+    }
+    return 0;
+#elif defined(__APPLE__)
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<size_t>(usage.ru_maxrss);
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+long long allocationCount()
+{
+    return allocationCounters.calls.load(memory_order_relaxed);
+}
@@ -0,0 +1,115 @@
+#ifndef RUNSTATS_H
+#define RUNSTATS_H
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/*
+ * Phase timing and resource use of one run of a tool (the -stats option)
+ *
+ * The run is divided into named phases such as "open", "parse", "query" and "output". phase() ends
+ * the current phase and starts the next, and a phase that is entered more than once adds up.
+ * When the run ends, one line of key=value pairs goes to stderr:
+ *
+ *  stats_tool=querydb phase_open_seconds=0.0001 phase_parse_seconds=0.93 ... total_seconds=0.95
+ *      parse_bytes=169675705 parse_records=1000000 parse_mb_per_s=182.4 parse_records_per_s=1075268
+ *      peak_rss_bytes=201326592 allocations=1234 load_source=text
+ *
+ * The parse rates are taken over the phases in which parsed() was called, whatever they are named, and
+ * the keys a tool adds with set() come last, in the order first set.
+ *
+ * Until enable() is called every member returns at once, and operator new only tests a flag, so the
+ * tools run at full speed without -stats.
+ */
+class RunStats {
+public:
+    RunStats() = default;
+    ~RunStats();
+
+    RunStats(const RunStats&) = delete;
+    RunStats& operator=(const RunStats&) = delete;
+
+    //Start measuring `tool`, in a first phase called `phase`
+    void enable(const std::string& tool, const char* phase);
+
+    bool enabled() const { return on; }
+
+    //The phase being timed (nullptr if not enabled)
+    const char* currentPhase() const { return current; }
+
+    //End the current phase and start `name` (a string literal)
+    void phase(const char* name)
+    {
+        if (on) {
+            startPhase(name);
+        }
+    }
+
+    //Count `bytes` of database text parsed (or scanned) into `records` records in the current phase
+    void parsed(uint64_t bytes, size_t records)
+    {
+        if (on) {
+            countParse(bytes, records);
+        }
+    }
+
+    //Add `key`=`value` to the report, replacing any value set for `key` before
+    template <typename T>
+    void set(const char* key, const T& value)
+    {
+        if (on) {
+            std::ostringstream text;
+            text << value;
+            setText(key, text.str());
+        }
+    }
+
+    //End the current phase and write everything measured to `op` on one line
+    void report(std::ostream& op);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void startPhase(const char* name);
+    void countParse(uint64_t bytes, size_t records);
+    void setText(const char* key, const std::string& value);
+
+    bool on = false;
+    bool reported = false;
+    std::string tool;
+    Clock::time_point start;
+    Clock::time_point phaseStart;
+    const char* current = nullptr;
+    std::vector<std::pair<const char*, double>> phases;    //Name and seconds, in the order first entered
+    std::vector<const char*> parsePhases;    //Phases in which parsed() was called
+    uint64_t parseBytes = 0;
+    size_t parseRecords = 0;
+    std::vector<std::pair<std::string, std::string>> extra;    //Keys added by set()
+};
+
+//Functions
+
+//The statistics of this run. If enabled, they are written to stderr as the program ends
+RunStats& runStats();
+
+//Peak resident set size of this process, in bytes (0 if unknown)
+size_t peakResidentBytes();
+
+//Number of times operator new has been called since runStats() was enabled
+long long allocationCount();
+
+//Allocations made while counting is on. Only programs that link countingnew.cpp (the countingnew target),
+//which replaces the global operator new and delete, fill these in; in any other program they stay at 0
+struct AllocationCounters {
+    std::atomic<bool> counting{false};
+    std::atomic<long long> calls{0};        //operator new calls
+    std::atomic<long long> liveBytes{0};    //Bytes allocated less bytes freed
+};
+extern AllocationCounters allocationCounters;
+
+#endif // RUNSTATS_H
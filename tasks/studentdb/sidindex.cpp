@@ -0,0 +1,285 @@
+#include "sidindex.h"
+#include "dbparser.h"
+#include "mappedfile.h"
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+using namespace std;
+
+static const char INDEX_MAGIC[8] = {'S', 'R', 'I', 'D', 'X', '\0', '\0', '\0'};
+static const uint32_t INDEX_VERSION = 1;
+
+//File header, followed by `capacity` slots
+struct IndexHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t sourceSize;
+    int64_t sourceMtime;
+    uint64_t capacity;
+    uint64_t count;
+};
+
+//One slot of the hash table. Empty slots have used == 0
+struct IndexSlot {
+    int32_t sid;
+    uint32_t used;
+    uint64_t offset;
+    uint64_t length;
+};
+
+//The table is kept at most half full, so probes stay short
+static const uint64_t MIN_CAPACITY = 64;
+
+//Home slot of `sid` in a table of `capacity` slots (a power of two)
+static uint64_t homeSlot(int sid, uint64_t capacity)
+{
+    //Mix the bits so that runs of consecutive IDs spread over the table
+    uint64_t x = static_cast<uint32_t>(sid);
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return x & (capacity - 1);
+}
+
+string indexFileName(const string& dataBaseName)
+{
+    return dataBaseName + ".idx";
+}
+
+bool indexExists(const string& dataBaseName)
+{
+    error_code ec;
+    return filesystem::exists(indexFileName(dataBaseName), ec);
+}
+
+bool buildIndex(const string& dataBaseName)
+{
+    //Take the stamp before reading, so a change made while scanning leaves the index out of date
+    SourceStamp stamp;
+    MappedFile db;
+    if (!sourceStamp(dataBaseName, stamp) || !db.open(dataBaseName)) {
+        return false;
+    }
+
+    vector<pair<int, RecordSpan>> records;
+    try {
+        scanRecords(db, [&records](int sid, size_t offset, size_t length) {
+            RecordSpan span;
+            span.offset = offset;
+            span.length = length;
+            records.emplace_back(sid, span);
+            return true;
+        });
+    } catch (exception&) {
+        return false;
+    }
+    db.close();
+
+    uint64_t capacity = MIN_CAPACITY;
+    while (capacity < records.size() * 2) {
+        capacity *= 2;
+    }
+
+    //Fill the table. The first record with an ID wins, as it does for every other lookup
+    vector<IndexSlot> table(capacity, IndexSlot{});
+    uint64_t count = 0;
+    for (const auto& [sid, span] : records) {
+        uint64_t n = homeSlot(sid, capacity);
+        while (table[n].used && table[n].sid != sid) {
+            n = (n + 1) & (capacity - 1);
+        }
+        if (!table[n].used) {
+            table[n] = {sid, 1, span.offset, span.length};
+            count++;
+        }
+    }
+
+    IndexHeader h{};
+    memcpy(h.magic, INDEX_MAGIC, sizeof(h.magic));
+    h.version = INDEX_VERSION;
+    h.sourceSize = stamp.size;
+    h.sourceMtime = stamp.mtime;
+    h.capacity = capacity;
+    h.count = count;
+
+    //Write to a temporary file, then rename it over the old index
+    string fileName = indexFileName(dataBaseName);
+    string tempName = fileName + ".tmp";
+    ofstream op(tempName, ios::binary | ios::trunc);
+    if (!op.is_open()) {
+        return false;
+    }
+    op.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    op.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(IndexSlot));
+    op.close();
+
+    error_code ec;
+    if (op.fail()) {
+        filesystem::remove(tempName, ec);
+        return false;
+    }
+    filesystem::rename(tempName, fileName, ec);
+    if (ec) {
+        filesystem::remove(tempName, ec);
+        return false;
+    }
+    return true;
+}
+
+bool readRecordAt(const string& dataBaseName, const RecordSpan& span, Record& r)
+{
+    ifstream ip(dataBaseName, ios::binary);
+    if (!ip.is_open()) {
+        return false;
+    }
+    string text(span.length, '\0');
+    ip.seekg(static_cast<streamoff>(span.offset));
+    ip.read(&text[0], static_cast<streamsize>(span.length));
+    if (!ip) {
+        return false;
+    }
+    ip.close();
+    return parseRecord(text, r);
+}
+
+bool SidIndex::open(const string& dataBaseName)
+{
+    close();
+
+    SourceStamp stamp;
+    if (!sourceStamp(dataBaseName, stamp)) {
+        return false;
+    }
+    string fileName = indexFileName(dataBaseName);
+    error_code ec;
+    uintmax_t fileSize = filesystem::file_size(fileName, ec);
+    if (ec) {
+        return false;
+    }
+    file.open(fileName, ios::in | ios::out | ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    IndexHeader h{};
+    file.read(reinterpret_cast<char*>(&h), sizeof(h));
+    if (!file
+        || memcmp(h.magic, INDEX_MAGIC, sizeof(h.magic)) != 0
+        || h.version != INDEX_VERSION
+        || h.sourceSize != stamp.size
+        || h.sourceMtime != stamp.mtime
+        || h.capacity < MIN_CAPACITY
+        || (h.capacity & (h.capacity - 1)) != 0
+        || fileSize != sizeof(IndexHeader) + h.capacity * sizeof(IndexSlot)) {
+        close();
+        return false;
+    }
+    this->dataBaseName = dataBaseName;
+    capacity = h.capacity;
+    count = h.count;
+    return true;
+}
+
+void SidIndex::close()
+{
+    if (file.is_open()) {
+        file.close();
+    }
+    file.clear();
+    capacity = 0;
+    count = 0;
+}
+
+bool SidIndex::readSlot(uint64_t n, IndexSlot& slot)
+{
+    file.seekg(static_cast<streamoff>(sizeof(IndexHeader) + n * sizeof(IndexSlot)));
+    file.read(reinterpret_cast<char*>(&slot), sizeof(slot));
+    return static_cast<bool>(file);
+}
+
+bool SidIndex::writeSlot(uint64_t n, const IndexSlot& slot)
+{
+    file.seekp(static_cast<streamoff>(sizeof(IndexHeader) + n * sizeof(IndexSlot)));
+    file.write(reinterpret_cast<const char*>(&slot), sizeof(slot));
+    return static_cast<bool>(file);
+}
+
+bool SidIndex::find(int sid, RecordSpan& span)
+{
+    IndexSlot slot;
+    uint64_t n = homeSlot(sid, capacity);
+    for (uint64_t probes = 0; probes < capacity; probes++) {
+        if (!readSlot(n, slot) || !slot.used) {
+            return false;
+        }
+        if (slot.sid == sid) {
+            span.offset = slot.offset;
+            span.length = slot.length;
+            return true;
+        }
+        n = (n + 1) & (capacity - 1);
+    }
+    return false;
+}
+
+bool SidIndex::add(int sid, const RecordSpan& span)
+{
+    return store(sid, span, false);
+}
+
+bool SidIndex::update(int sid, const RecordSpan& span)
+{
+    return store(sid, span, true);
+}
+
+bool SidIndex::store(int sid, const RecordSpan& span, bool replace)
+{
+    if (!isOpen()) {
+        return false;
+    }
+
+    IndexSlot slot;
+    uint64_t n = homeSlot(sid, capacity);
+    while (true) {
+        if (!readSlot(n, slot)) {
+            return false;
+        }
+        if (!slot.used || slot.sid == sid) {
+            break;
+        }
+        n = (n + 1) & (capacity - 1);
+    }
+
+    //Grow the table by rebuilding it once a new ID would make it more than half full
+    if (!slot.used && (count + 1) * 2 > capacity) {
+        close();
+        return buildIndex(dataBaseName);
+    }
+    //An ID that is already present keeps pointing at its first record, unless that record has moved
+    if (!slot.used || replace) {
+        if (!writeSlot(n, IndexSlot{sid, 1, span.offset, span.length})) {
+            return false;
+        }
+        count += !slot.used;
+    }
+
+    //The index now matches the database again
+    SourceStamp stamp;
+    if (!sourceStamp(dataBaseName, stamp)) {
+        return false;
+    }
+    IndexHeader h{};
+    memcpy(h.magic, INDEX_MAGIC, sizeof(h.magic));
+    h.version = INDEX_VERSION;
+    h.sourceSize = stamp.size;
+    h.sourceMtime = stamp.mtime;
+    h.capacity = capacity;
+    h.count = count;
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    file.flush();
+    return static_cast<bool>(file);
+}
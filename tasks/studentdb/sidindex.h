@@ -0,0 +1,78 @@
+#ifndef SIDINDEX_H
+#define SIDINDEX_H
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include "snapshot.h"
+#include "studentrecord.h"
+
+/*
+ * Persistent student ID index, kept alongside a text database as <database>.idx
+ *
+ * The index is an open-addressing hash table on disk that maps each student ID to the byte offset
+ * and length of its record in the text file, so a lookup reads a couple of table slots and then
+ * one record instead of the whole database.
+ * Like the snapshot, it remembers the size and modification time of the text file and is ignored
+ * (or rebuilt) as soon as they no longer match.
+ */
+
+//Layout of one slot of the table (defined in sidindex.cpp)
+struct IndexSlot;
+
+//Position of a record's text in the database file
+struct RecordSpan {
+    uint64_t offset = 0;
+    uint64_t length = 0;
+};
+
+//Functions
+
+//Name of the index file for the database `dataBaseName`
+std::string indexFileName(const std::string& dataBaseName);
+
+//Does an index file (up to date or not) exist for `dataBaseName`?
+bool indexExists(const std::string& dataBaseName);
+
+//Build (or rebuild) the index for `dataBaseName` by scanning the whole text file
+//Returns false if the database cannot be read or the index cannot be written
+bool buildIndex(const std::string& dataBaseName);
+
+//Read and parse the record at `span` in `dataBaseName`. Returns false if it cannot be read
+//Throws an exception if the record is malformed
+bool readRecordAt(const std::string& dataBaseName, const RecordSpan& span, Record& r);
+
+//Open index of one database
+class SidIndex {
+public:
+    //Open the index of `dataBaseName`. Returns false if it is missing, damaged or out of date
+    bool open(const std::string& dataBaseName);
+    void close();
+
+    bool isOpen() const { return file.is_open(); }
+
+    //Find the first record with student ID `sid`. Returns false if there is none
+    bool find(int sid, RecordSpan& span);
+
+    //Record that a record with student ID `sid` has just been appended to the database at `span`,
+    //and mark the index as matching the database again. Returns false if the index could not be updated
+    bool add(int sid, const RecordSpan& span);
+
+    //Record that the record with student ID `sid` is now at `span` (it was rewritten or moved, see recordpatch.h),
+    //and mark the index as matching the database again. Returns false if the index could not be updated
+    bool update(int sid, const RecordSpan& span);
+
+private:
+    //Body of add and update. An existing entry for `sid` is only changed if `replace` is set
+    bool store(int sid, const RecordSpan& span, bool replace);
+
+    //Read/write slot number `n` of the table
+    bool readSlot(uint64_t n, IndexSlot& slot);
+    bool writeSlot(uint64_t n, const IndexSlot& slot);
+
+    std::fstream file;
+    std::string dataBaseName;
+    uint64_t capacity = 0;
+    uint64_t count = 0;
+};
+
+#endif // SIDINDEX_H
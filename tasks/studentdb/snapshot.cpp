@@ -0,0 +1,357 @@
+#include "snapshot.h"
+#include "delta.h"
+#include "dbparser.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+using namespace std;
+
+//Bump the version whenever the layout below changes - older snapshots are then simply rebuilt
+static const char SNAPSHOT_MAGIC[8] = {'S', 'R', 'S', 'N', 'A', 'P', '\0', '\0'};
+static const uint32_t SNAPSHOT_VERSION = 1;
+
+//File header. The sections follow it in this order, each starting on an 8 byte boundary:
+//module table, record table, SID index, enrollment module IDs, grades, string data
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t sourceSize;
+    int64_t sourceMtime;
+    uint64_t recordCount;
+    uint64_t moduleCount;
+    uint64_t enrollmentCount;
+    uint64_t gradeCount;
+    uint64_t stringBytes;
+};
+
+//An interned module code (a slice of the string data)
+struct ModuleEntry {
+    uint32_t offset;
+    uint32_t length;
+};
+
+//Fixed-width record entry. Strings are slices of the string data, lists are slices of the ID/grade arrays
+struct RecordEntry {
+    int32_t sid;
+    uint32_t nameOffset;
+    uint32_t nameLength;
+    uint32_t phoneOffset;
+    uint32_t phoneLength;
+    uint32_t enrollmentFirst;
+    uint32_t enrollmentCount;
+    uint32_t gradeFirst;
+    uint32_t gradeCount;
+};
+
+//SID index entry, sorted by SID (then by position, so the first record in the file wins)
+struct SidEntry {
+    int32_t sid;
+    uint32_t record;
+};
+
+//Byte offset of each section
+struct SnapshotLayout {
+    uint64_t modules, records, sids, enrollments, grades, strings, end;
+};
+
+static uint64_t align8(uint64_t n)
+{
+    return (n + 7) & ~uint64_t(7);
+}
+
+static SnapshotLayout layoutOf(const SnapshotHeader& h)
+{
+    SnapshotLayout l;
+    l.modules = align8(sizeof(SnapshotHeader));
+    l.records = align8(l.modules + h.moduleCount * sizeof(ModuleEntry));
+    l.sids = align8(l.records + h.recordCount * sizeof(RecordEntry));
+    l.enrollments = align8(l.sids + h.recordCount * sizeof(SidEntry));
+    l.grades = align8(l.enrollments + h.enrollmentCount * sizeof(uint32_t));
+    l.strings = align8(l.grades + h.gradeCount * sizeof(float));
+    l.end = l.strings + h.stringBytes;
+    return l;
+}
+
+string snapshotFileName(const string& dataBaseName)
+{
+    return dataBaseName + ".snap";
+}
+
+bool sourceStamp(const string& fileName, SourceStamp& stamp)
+{
+    error_code ec;
+    uintmax_t size = filesystem::file_size(fileName, ec);
+    if (ec) {
+        return false;
+    }
+    auto mtime = filesystem::last_write_time(fileName, ec);
+    if (ec) {
+        return false;
+    }
+    stamp.size = size;
+    stamp.mtime = static_cast<int64_t>(mtime.time_since_epoch().count());
+    return true;
+}
+
+//Write `count` items followed by padding up to the next 8 byte boundary
+template <typename T>
+static void writeSection(ofstream& op, const T* items, size_t count)
+{
+    static const char zeros[8] = {};
+    size_t bytes = count * sizeof(T);
+    op.write(reinterpret_cast<const char*>(items), bytes);
+    op.write(zeros, align8(bytes) - bytes);
+}
+
+bool writeSnapshot(const string& dataBaseName, const RecordStore& db, const SourceStamp& stamp)
+{
+    vector<ModuleEntry> modules;
+    vector<RecordEntry> records;
+    vector<SidEntry> sids;
+    vector<uint32_t> enrollments;
+    vector<float> grades;
+    string strings;
+    vector<int64_t> moduleIndex(moduleDictionary().size(), -1);    //Dictionary ID -> module table entry
+
+    records.reserve(db.size());
+    sids.reserve(db.size());
+
+    //Append `s` to the string data, returning false if the snapshot would outgrow its 32 bit offsets
+    auto addString = [&strings](string_view s, uint32_t& offset, uint32_t& length) {
+        if (strings.size() + s.size() > UINT32_MAX) {
+            return false;
+        }
+        offset = static_cast<uint32_t>(strings.size());
+        length = static_cast<uint32_t>(s.size());
+        strings += s;
+        return true;
+    };
+
+    for (size_t n = 0; n < db.size(); n++) {
+        RecordView r = db[n];
+        RecordEntry e{};
+        e.sid = r.SID;
+        if (!addString(r.name, e.nameOffset, e.nameLength) || !addString(r.phone, e.phoneOffset, e.phoneLength)) {
+            return false;
+        }
+
+        e.enrollmentFirst = static_cast<uint32_t>(enrollments.size());
+        e.enrollmentCount = static_cast<uint32_t>(r.enrollments.size());
+        for (ModuleId id : r.enrollments) {
+            if (moduleIndex[id] < 0) {
+                ModuleEntry m;
+                if (!addString(moduleName(id), m.offset, m.length)) {
+                    return false;
+                }
+                moduleIndex[id] = static_cast<int64_t>(modules.size());
+                modules.push_back(m);
+            }
+            enrollments.push_back(static_cast<uint32_t>(moduleIndex[id]));
+        }
+
+        e.gradeFirst = static_cast<uint32_t>(grades.size());
+        e.gradeCount = static_cast<uint32_t>(r.grades.size());
+        grades.insert(grades.end(), r.grades.begin(), r.grades.end());
+
+        sids.push_back({e.sid, static_cast<uint32_t>(records.size())});
+        records.push_back(e);
+    }
+
+    stable_sort(sids.begin(), sids.end(), [](const SidEntry& a, const SidEntry& b) {
+        return a.sid < b.sid;
+    });
+
+    SnapshotHeader h{};
+    memcpy(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic));
+    h.version = SNAPSHOT_VERSION;
+    h.sourceSize = stamp.size;
+    h.sourceMtime = stamp.mtime;
+    h.recordCount = records.size();
+    h.moduleCount = modules.size();
+    h.enrollmentCount = enrollments.size();
+    h.gradeCount = grades.size();
+    h.stringBytes = strings.size();
+
+    //Write to a temporary file, then rename it over the old snapshot so readers never see half a file
+    string fileName = snapshotFileName(dataBaseName);
+    string tempName = fileName + ".tmp";
+    ofstream op(tempName, ios::binary | ios::trunc);
+    if (!op.is_open()) {
+        return false;
+    }
+    writeSection(op, &h, 1);
+    writeSection(op, modules.data(), modules.size());
+    writeSection(op, records.data(), records.size());
+    writeSection(op, sids.data(), sids.size());
+    writeSection(op, enrollments.data(), enrollments.size());
+    writeSection(op, grades.data(), grades.size());
+    writeSection(op, strings.data(), strings.size());
+    op.close();
+
+    error_code ec;
+    if (op.fail()) {
+        filesystem::remove(tempName, ec);
+        return false;
+    }
+    filesystem::rename(tempName, fileName, ec);
+    if (ec) {
+        filesystem::remove(tempName, ec);
+        return false;
+    }
+    return true;
+}
+
+bool loadDatabase(const string& dataBaseName, RecordStore& db, unsigned threads)
+{
+    //Use the snapshot if it is up to date
+    Snapshot snapshot;
+    if (snapshot.open(dataBaseName)) {
+        snapshot.loadAll(db);
+        mergeDeltas(dataBaseName, db);
+        return true;
+    }
+
+    //Take the stamp before reading, so a change made while parsing leaves the new snapshot out of date
+    SourceStamp stamp;
+    bool haveStamp = sourceStamp(dataBaseName, stamp);
+
+    MappedFile file;
+    if (!file.open(dataBaseName)) {
+        return false;
+    }
+    parseDatabaseParallel(file.view(), db, threads);
+
+    //Only rebuild a snapshot that already exists - a missing one means the user has not asked for it
+    error_code ec;
+    if (haveStamp && filesystem::exists(snapshotFileName(dataBaseName), ec)) {
+        writeSnapshot(dataBaseName, db, stamp);
+    }
+    mergeDeltas(dataBaseName, db);
+    return true;
+}
+
+bool Snapshot::open(const string& dataBaseName)
+{
+    close();
+
+    SourceStamp stamp;
+    if (!sourceStamp(dataBaseName, stamp) || !file.open(snapshotFileName(dataBaseName))) {
+        return false;
+    }
+
+    //Check the header before trusting anything else in the file
+    const SnapshotHeader* h = reinterpret_cast<const SnapshotHeader*>(file.view().data());
+    if (file.size() < sizeof(SnapshotHeader)
+        || memcmp(h->magic, SNAPSHOT_MAGIC, sizeof(h->magic)) != 0
+        || h->version != SNAPSHOT_VERSION
+        || h->sourceSize != stamp.size
+        || h->sourceMtime != stamp.mtime
+        || layoutOf(*h).end > file.size()) {
+        close();
+        return false;
+    }
+    header = h;
+
+    //Intern the snapshot's module codes once, so records can be copied out as plain IDs
+    SnapshotLayout l = layoutOf(*h);
+    const ModuleEntry* modules = reinterpret_cast<const ModuleEntry*>(file.view().data() + l.modules);
+    string_view strings(file.view().data() + l.strings, h->stringBytes);
+    moduleIds.clear();
+    for (uint64_t i = 0; i < h->moduleCount; i++) {
+        if (uint64_t(modules[i].offset) + modules[i].length > strings.size()) {
+            close();
+            return false;
+        }
+        moduleIds.push_back(moduleId(strings.substr(modules[i].offset, modules[i].length)));
+    }
+    return true;
+}
+
+void Snapshot::close()
+{
+    file.close();
+    header = nullptr;
+    moduleIds.clear();
+}
+
+size_t Snapshot::size() const
+{
+    return header ? static_cast<size_t>(header->recordCount) : 0;
+}
+
+RecordView Snapshot::view(size_t n, vector<ModuleId>& ids) const
+{
+    SnapshotLayout l = layoutOf(*header);
+    const char* base = file.view().data();
+    const RecordEntry& e = reinterpret_cast<const RecordEntry*>(base + l.records)[n];
+    const uint32_t* enrollments = reinterpret_cast<const uint32_t*>(base + l.enrollments);
+    const float* grades = reinterpret_cast<const float*>(base + l.grades);
+    string_view strings(base + l.strings, header->stringBytes);
+
+    //A damaged file must not make us read outside the mapping
+    if (uint64_t(e.enrollmentFirst) + e.enrollmentCount > header->enrollmentCount
+        || uint64_t(e.gradeFirst) + e.gradeCount > header->gradeCount
+        || uint64_t(e.nameOffset) + e.nameLength > strings.size()
+        || uint64_t(e.phoneOffset) + e.phoneLength > strings.size()) {
+        throw runtime_error("Snapshot is damaged");
+    }
+
+    ids.clear();
+    for (uint32_t i = 0; i < e.enrollmentCount; i++) {
+        uint32_t id = enrollments[e.enrollmentFirst + i];
+        if (id >= moduleIds.size()) {
+            throw runtime_error("Snapshot is damaged");
+        }
+        ids.push_back(moduleIds[id]);
+    }
+
+    RecordView v;
+    v.SID = e.sid;
+    v.name = strings.substr(e.nameOffset, e.nameLength);
+    v.phone = strings.substr(e.phoneOffset, e.phoneLength);
+    v.enrollments = {ids.data(), ids.size()};
+    v.grades = {grades + e.gradeFirst, e.gradeCount};
+    return v;
+}
+
+Record Snapshot::record(size_t n) const
+{
+    vector<ModuleId> ids;
+    RecordView v = view(n, ids);
+    Record r{};
+    r.SID = v.SID;
+    r.name = v.name;
+    r.enrollments = move(ids);
+    r.grades.assign(v.grades.begin(), v.grades.end());
+    r.phone = v.phone;
+    return r;
+}
+
+long long Snapshot::find(int sid) const
+{
+    if (!header) {
+        return -1;
+    }
+    const SidEntry* first = reinterpret_cast<const SidEntry*>(file.view().data() + layoutOf(*header).sids);
+    const SidEntry* last = first + header->recordCount;
+    const SidEntry* it = lower_bound(first, last, sid, [](const SidEntry& e, int value) {
+        return e.sid < value;
+    });
+    if (it == last || it->sid != sid || it->record >= header->recordCount) {
+        return -1;
+    }
+    return it->record;
+}
+
+void Snapshot::loadAll(RecordStore& db) const
+{
+    vector<ModuleId> ids;
+    db.reserve(size());
+    for (size_t n = 0; n < size(); n++) {
+        db.add(view(n, ids));
+    }
+}
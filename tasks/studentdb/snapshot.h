@@ -0,0 +1,79 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "mappedfile.h"
+#include "recordstore.h"
+#include "studentrecord.h"
+
+/*
+ * Compiled binary snapshot of a text database, kept alongside it as <database>.snap
+ *
+ * The snapshot holds fixed-width record entries, a sorted SID index, the interned module codes
+ * and one block of string data, so it can be used straight from a memory mapping.
+ * It remembers the size and modification time of the text file it was built from,
+ * and is ignored as soon as the text file changes.
+ */
+
+//Layout of the file header (defined in snapshot.cpp)
+struct SnapshotHeader;
+
+//Size and modification time of a text database, used to tell if a snapshot is out of date
+struct SourceStamp {
+    uint64_t size = 0;
+    int64_t mtime = 0;
+};
+
+//Functions
+
+//Name of the snapshot file for the database `dataBaseName`
+std::string snapshotFileName(const std::string& dataBaseName);
+
+//Read the stamp of `fileName`. Returns false if the file does not exist
+bool sourceStamp(const std::string& fileName, SourceStamp& stamp);
+
+//Write the snapshot for `dataBaseName` holding `db`, which was read when the text file had stamp `stamp`
+//The file is replaced atomically. Returns false if it could not be written
+bool writeSnapshot(const std::string& dataBaseName, const RecordStore& db, const SourceStamp& stamp);
+
+//Load every record of `dataBaseName` into `db`, using the snapshot where possible
+// o If the snapshot is up to date, it is loaded instead of parsing the text
+// o If the snapshot exists but is out of date, the text is parsed and the snapshot rebuilt
+// o If there is no snapshot, the text is parsed
+// o Any changes waiting in the delta log are then applied (see delta.h)
+//The text is parsed on `threads` threads (see parseDatabaseParallel)
+//Returns false if the database cannot be opened. Throws an exception if the text is malformed
+bool loadDatabase(const std::string& dataBaseName, RecordStore& db, unsigned threads = 1);
+
+//Read-only view of a snapshot file
+class Snapshot {
+public:
+    //Open the snapshot for `dataBaseName`. Returns false if it is missing, damaged or out of date
+    bool open(const std::string& dataBaseName);
+    void close();
+
+    bool isOpen() const { return file.isOpen(); }
+
+    //Number of records
+    size_t size() const;
+
+    //Copy record number `n` (in file order) out of the snapshot
+    Record record(size_t n) const;
+
+    //Position of the first record with student ID `sid`, or -1 if there is none
+    long long find(int sid) const;
+
+    //Copy every record into `db`
+    void loadAll(RecordStore& db) const;
+
+private:
+    //View of record number `n`, with its module IDs translated into `ids`
+    RecordView view(size_t n, std::vector<ModuleId>& ids) const;
+
+    MappedFile file;
+    const SnapshotHeader* header = nullptr;
+    std::vector<ModuleId> moduleIds;    //Module table entry -> ID in the module dictionary
+};
+
+#endif // SNAPSHOT_H
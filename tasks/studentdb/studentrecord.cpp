@@ -0,0 +1,9 @@
+#include "studentrecord.h"
+#include "recordwriter.h"
+using namespace std;
+
+//Function to display a record in the terminal
+void printRecord(Record& r)
+{
+    printRecord(viewOf(r));
+}
@@ -2,16 +2,19 @@
 #define STUDENTRECORD_H
 #include <iostream>
 #include <vector>
+#include "moduledict.h"
 
 //Basic data structure for a record
 struct Record {
     int SID;        //Student ID
     std::string name;    //Student Name
-    std::vector<std::string> enrollments;
+    std::vector<ModuleId> enrollments;    //Module codes (see moduleName)
     std::vector<float> grades;
     std::string phone;
 };
 
 void printRecord(Record& r);
 
+
+
 #endif // STUDENTRECORD_H
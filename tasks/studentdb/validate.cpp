@@ -0,0 +1,121 @@
+#include "validate.h"
+#include <array>
+#include <cstdint>
+using namespace std;
+
+//Character classes, as bits of one table entry per character
+enum CharClass : uint8_t {
+    DIGIT = 1,      //[0-9]
+    LETTER = 2,     //[a-zA-Z]
+    SPACE = 4,      //\s - space, tab, newline, vertical tab, form feed, carriage return
+    DASH = 8,       //-
+    CONTROL = 16    //[\x00-\x1f\x7f]
+};
+
+static constexpr array<uint8_t, 256> makeClasses()
+{
+    array<uint8_t, 256> classes{};
+    for (int c = '0'; c <= '9'; c++) {
+        classes[c] |= DIGIT;
+    }
+    for (int c = 'a'; c <= 'z'; c++) {
+        classes[c] |= LETTER;
+        classes[c - 'a' + 'A'] |= LETTER;
+    }
+    for (char c : {' ', '\t', '\n', '\v', '\f', '\r'}) {
+        classes[static_cast<unsigned char>(c)] |= SPACE;
+    }
+    classes['-'] |= DASH;
+    for (int c = 0; c < 0x20; c++) {
+        classes[c] |= CONTROL;
+    }
+    classes[0x7f] |= CONTROL;
+    return classes;
+}
+
+static constexpr array<uint8_t, 256> CLASSES = makeClasses();
+
+//Is `c` in any of the classes `mask`?
+static inline bool in(char c, uint8_t mask)
+{
+    return (CLASSES[static_cast<unsigned char>(c)] & mask) != 0;
+}
+
+//Length of the run of characters in `mask` starting at `start`
+static inline size_t run(string_view text, size_t start, uint8_t mask)
+{
+    size_t end = start;
+    while (end < text.size() && in(text[end], mask)) {
+        end++;
+    }
+    return end - start;
+}
+
+//Is all of `text` (at least one character) in the classes `mask`?
+static inline bool allIn(string_view text, uint8_t mask)
+{
+    return !text.empty() && run(text, 0, mask) == text.size();
+}
+
+bool isValidStudentId(string_view sid)
+{
+    return allIn(sid, DIGIT);
+}
+
+bool isValidName(string_view name)
+{
+    //[a-zA-Z]+ then ' '
+    size_t pos = run(name, 0, LETTER);
+    if (pos == 0 || pos == name.size() || name[pos] != ' ') {
+        return false;
+    }
+    pos++;
+
+    //([\s][a-zA-Z]+)+ to the end
+    size_t groups = 0;
+    while (pos < name.size()) {
+        if (!in(name[pos], SPACE)) {
+            return false;
+        }
+        size_t letters = run(name, pos + 1, LETTER);
+        if (letters == 0) {
+            return false;
+        }
+        pos += 1 + letters;
+        groups++;
+    }
+    return groups > 0;
+}
+
+bool isStorableName(string_view name)
+{
+    for (char c : name) {
+        if (in(c, CONTROL)) {
+            return false;
+        }
+    }
+    return !name.empty();
+}
+
+bool isValidPhoneNumber(string_view phone)
+{
+    return allIn(phone, DIGIT | DASH);
+}
+
+bool isValidModuleCode(string_view code)
+{
+    return allIn(code, DIGIT | LETTER);
+}
+
+bool isValidGrade(string_view grade)
+{
+    size_t whole = run(grade, 0, DIGIT);
+    if (whole == 0) {
+        return false;
+    }
+    if (whole == grade.size()) {
+        return true;
+    }
+    //\.[0-9]+ to the end
+    return grade[whole] == '.' && whole + 1 < grade.size() && run(grade, whole + 1, DIGIT) == grade.size() - whole - 1;
+}
@@ -0,0 +1,38 @@
+#ifndef VALIDATE_H
+#define VALIDATE_H
+#include <string_view>
+
+/*
+ * Checks of the values given to the tools on the command line or in an import file
+ *
+ * Each check is a hand-written matcher over a character class table built at compile time, with no
+ * allocation and no regex to build. Each accepts exactly the text matched by the expression shown with
+ * it. Those are the regular expressions updaterecord and addrecord used for these values, except the
+ * student ID, which updaterecord checked with a scan for anything but digits, and the storable name,
+ * which is new. Letters and digits are ASCII only, as in the expressions.
+ */
+
+//Functions
+
+//^[0-9]+$ - a student ID
+bool isValidStudentId(std::string_view sid);
+
+//^[a-zA-Z]+ ([\s][a-zA-Z]+)+$ - updaterecord's name rule. Note that this asks for a space and then
+//another whitespace character before the second word, and one before each later word, e.g. "Jo  Kingly Blunt"
+bool isValidName(std::string_view name);
+
+//^[^\x00-\x1f\x7f]+$ - a name that can be written to the database: not empty, and with no line break
+//or other control character that could start a line of its own. Nothing else about a name is checked by
+//addrecord, which takes any such name
+bool isStorableName(std::string_view name);
+
+//^[0-9-]+$ - a phone number
+bool isValidPhoneNumber(std::string_view phone);
+
+//^[a-zA-Z0-9]+$ - a module code
+bool isValidModuleCode(std::string_view code);
+
+//^[0-9]+(\.[0-9]+)?$ - a grade
+bool isValidGrade(std::string_view grade);
+
+#endif // VALIDATE_H